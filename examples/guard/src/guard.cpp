@@ -1,7 +1,9 @@
 #include "guard.hpp"
 
 #include "image_data.hpp"
+#include <libchamber/primitives.hpp>
 #include <libchamber/print.hpp>
+#include <libchamber/viewport.hpp>
 #include <ranges>
 
 void init(size_t max_num_balls, size_t max_canvas_size)
@@ -9,13 +11,17 @@ void init(size_t max_num_balls, size_t max_canvas_size)
     chamber::init<GuardChamber>(max_num_balls, max_canvas_size);
 }
 
+float const STEP_LEN_S = 1.666666f / 1300.0f; // Equivalent to step_len_s in your code
+
 GuardChamber::GuardChamber(size_t max_balls, size_t max_canvas_size)
     : Chamber(max_balls, max_canvas_size)
+    , m_orb(orb_data, ORB_IMAGE_WIDTH, ORB_IMAGE_HEIGHT)
 {
+    // Step like the server does so the predictions line up with what the balls do
+    static constexpr int MAX_SUBSTEPS = 32;
+    set_fixed_step(STEP_LEN_S, MAX_SUBSTEPS);
 }
 
-float const STEP_LEN_S = 1.666666f / 1300.0f; // Equivalent to step_len_s in your code
-
 void clamp_speed(ball* ball)
 {
     auto const max_speed = 2.5;
@@ -200,6 +206,8 @@ pos2 offset_position(pos2 pos, Guard const& guard, ball* ball, vec2 velocity)
 
 void GuardChamber::step(size_t num_balls, float delta)
 {
+    m_guard.prev_pos = m_guard.pos;
+
     for (auto& ball : std::ranges::views::take(m_balls, num_balls)) {
         apply_gravity(&ball, delta);
     }
@@ -276,125 +284,20 @@ void GuardChamber::step(size_t num_balls, float delta)
 
 void GuardChamber::render(size_t canvas_width, size_t canvas_height)
 {
-    m_canvas_width = canvas_width;
-    m_canvas_height = canvas_height;
+    chamber::Viewport const viewport(canvas_width, canvas_height);
 
     //
     // Do rendering..
     //
-    auto const draw_horizontal_line = [&](int x1, int x2, int y) {
-        for (int i = x1; i < x2; i++) {
-            m_canvas[i + y * canvas_width] = 0xFF000000;
-        }
-    };
-    auto const draw_circle = [&](int x, int y, int radius, uint32_t color) {
-        for (int i = -radius; i < radius; i++) {
-            for (int j = -radius; j < radius; j++) {
-                if (i * i + j * j < radius * radius) {
-                    auto const index = (x + i) + (y + j) * canvas_width;
-                    if (index >= 0 && index < canvas_width * canvas_height) {
-                        m_canvas[index] = color;
-                    }
-                }
-            }
-        }
-    };
-
-    auto const fill_screen = [this](uint32_t color) {
-        for (size_t i = 0; i < m_canvas_width * m_canvas_height; ++i) {
-            m_canvas[i] = color;
-        }
-    };
-    fill_screen(0xFFFFFFFF);
-
-    auto const draw_line = [this](int x1, int y1, int x2, int y2, uint32_t color) {
-        int dx = std::abs(x2 - x1);
-        int dy = std::abs(y2 - y1);
-        int sx = x1 < x2 ? 1 : -1;
-        int sy = y1 < y2 ? 1 : -1;
-        int err = dx - dy;
-        while (x1 != x2 || y1 != y2) {
-            if (x1 >= 0 && x1 < m_canvas_width && y1 >= 0 && y1 < m_canvas_height) {
-                m_canvas[x1 + y1 * m_canvas_width] = color;
-            }
-            int e2 = 2 * err;
-            if (e2 > -dy) {
-                err -= dy;
-                x1 += sx;
-            }
-            if (e2 < dx) {
-                err += dx;
-                y1 += sy;
-            }
-        }
-    };
+    chamber::fill_rect(viewport.bounds(), 0xFFFFFFFF, viewport.bounds(), m_canvas, canvas_width);
 
-    auto const pos2pix_x = [&](float x_norm) {
-        return x_norm * static_cast<float>(canvas_width);
-    };
-    auto const pos2pix_y = [&](float y_norm) {
-        return static_cast<float>(canvas_height) - y_norm * static_cast<float>(canvas_width);
+    float const alpha = interpolation_alpha();
+    pos2 const guard_pos = {
+        .x = lerp(m_guard.prev_pos.x, m_guard.pos.x, alpha),
+        .y = lerp(m_guard.prev_pos.y, m_guard.pos.y, alpha),
     };
-
-    draw_image(
-        orb_data.data(),
-        20, 22,
-        (int)pos2pix_x(m_guard.pos.x), (int)pos2pix_y(m_guard.pos.y));
-
-    if (m_guard.has_target) {
-        // draw_circle(pos2pix_x(m_guard.target.predicted_pos.x), pos2pix_y(m_guard.target.predicted_pos.y), 10, 0xFFFF00FF);
-        //  draw_circle(pos2pix_x(m_guard.target.predicted_pos_naive.x), pos2pix_y(m_guard.target.predicted_pos_naive.y), 10, 0xFF00FFFF);
-        //   draw_line(
-        //       pos2pix_x(m_guard.pos.x), pos2pix_y(m_guard.pos.y),
-        //       pos2pix_x(m_guard.target.predicted_pos.x), pos2pix_y(m_guard.target.predicted_pos.y),
-        //       0xFF0000FF);
-    }
-    // draw_circle(pos2pix_x(m_guard.target.pos.x), pos2pix_y(m_guard.target.ball.pos.y), 10);
-}
-
-void GuardChamber::draw_image(uint32_t const* data, int image_width, int image_height, int x, int y)
-{
-    vec2 middle = { image_width / 2.F, image_height / 2.F };
-
-    for (int i = 0; i < image_width; ++i) {
-        for (int j = 0; j < image_height; ++j) {
-            int index = i + j * image_width;
-
-            int x_pos = x - middle.x + i;
-            int y_pos = y - middle.y + j;
-            if (x_pos < 0 || x_pos >= m_canvas_width || y_pos < 0 || y_pos >= m_canvas_height) {
-                continue;
-            }
-
-            uint32_t src = data[index];
-            uint32_t dst = m_canvas.at(x_pos + y_pos * m_canvas_width);
-
-            uint8_t srcAlpha = (src >> 24) & 0xFF;
-            uint8_t srcRed = (src >> 16) & 0xFF;
-            uint8_t srcGreen = (src >> 8) & 0xFF;
-            uint8_t srcBlue = src & 0xFF;
-
-            uint8_t dstAlpha = (dst >> 24) & 0xFF;
-            uint8_t dstRed = (dst >> 16) & 0xFF;
-            uint8_t dstGreen = (dst >> 8) & 0xFF;
-            uint8_t dstBlue = dst & 0xFF;
-
-            // Perform alpha blending for each component
-            float srcAlphaNormalized = srcAlpha / 255.0f;
-            uint8_t newRed = srcRed * srcAlphaNormalized + dstRed * (1 - srcAlphaNormalized);
-            uint8_t newGreen = srcGreen * srcAlphaNormalized + dstGreen * (1 - srcAlphaNormalized);
-            uint8_t newBlue = srcBlue * srcAlphaNormalized + dstBlue * (1 - srcAlphaNormalized);
-            uint8_t newAlpha = dstAlpha; // Optionally, calculate the new alpha as well if needed
-
-            // Combine into a single uint32_t
-            uint32_t newColor = static_cast<uint32_t>((newAlpha << 24) | (newRed << 16) | (newGreen << 8) | newBlue);
-            if (x_pos + y_pos * m_canvas_width >= (m_canvas_width * m_canvas_height) * 4) {
-                continue;
-            }
-            // continue;
-            // m_canvas.at(x_pos + y_pos * m_canvas_width) = 0xFFFFFFFF;
-            // m_canvas.at(x_pos + y_pos * m_canvas_width) = 0x000000FF;
-            m_canvas.at(x_pos + y_pos * m_canvas_width) = newColor;
-        }
-    }
+    float const orb_width = 2.F * m_guard.radius * viewport.scale();
+    float const orb_height = orb_width * ORB_IMAGE_HEIGHT / ORB_IMAGE_WIDTH;
+    chamber::draw_sprite(m_orb, viewport.to_pixels(guard_pos), orb_width, orb_height,
+        viewport.bounds(), chamber::SpriteFilter::BILINEAR, m_canvas, canvas_width);
 }
@@ -1,5 +1,6 @@
 #include <libchamber/chamber.hpp>
 #include <libchamber/exports.h>
+#include <libchamber/sprite.hpp>
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -17,6 +18,7 @@ struct Target {
 struct Guard {
     pos2 start_pos { 0.5, 0.5 };
     pos2 pos { 0.5, 0.5 };
+    pos2 prev_pos { 0.5, 0.5 }; // Before the last step, drawn interpolated
     // vec2 velocity;
     float radius { 0.035 };
 
@@ -48,7 +50,12 @@ public:
     void* save_memory() override { return &m_save_guard_pos; }
     size_t save_size() override { return sizeof(m_save_guard_pos); }
     void save() override { m_save_guard_pos = m_guard.pos; }
-    void load() override { m_guard.pos = m_save_guard_pos; }
+    void load() override
+    {
+        m_guard.pos = m_save_guard_pos;
+        m_guard.prev_pos = m_save_guard_pos;
+        reset_schedule();
+    }
 
 private:
     enum class BallResultState {
@@ -63,10 +70,11 @@ private:
     };
 
     BallResult find_ball(size_t num_balls, float time_to_target);
-    void draw_image(uint32_t const* data, int image_width, int image_height, int x, int y);
+
+    static constexpr int ORB_IMAGE_WIDTH = 20;
+    static constexpr int ORB_IMAGE_HEIGHT = 22;
 
 private:
     Guard m_guard;
-    size_t m_canvas_width;
-    size_t m_canvas_height;
+    chamber::Sprite m_orb; // Scaled so its width matches the guard's diameter
 };
@@ -51,7 +51,8 @@
 // - Bicubic convolution resampling is used whenever it needs to resample a
 //     pattern or image.  This smoothly interpolates with less blockiness when
 //     magnifying, and antialiases well when minifying.  It can simultaneously
-//     magnify and minify along different axes.
+//     magnify and minify along different axes.  Cheaper bilinear or nearest
+//     neighbor filtering can be chosen instead where speed matters more.
 // - Ordered dithering is used on output.  This reduces banding on subtle
 //     gradients while still being compression-friendly.
 // - High curvature is handled carefully in line joins.  Thick lines are
@@ -108,9 +109,10 @@
 // - TRUETYPE FONT PARSING IS NOT SECURE!  It does some basic validity
 //     checking, but should only be used with known-good or sanitized fonts.
 // - Parameter checking does not test for non-finite floating-point values.
-// - Rendering is single-threaded, not explicitly vectorized, and not GPU-
-//     accelerated.  It also copies data to avoid ownership issues.  If you
-//     need the speed, you are better off using a more fully-featured library.
+// - Rendering is single-threaded unless opted into, only explicitly
+//     vectorized for blending solid colors, and not GPU-accelerated.  It
+//     also copies data to avoid ownership issues.  If you need the speed,
+//     you are better off using a more fully-featured library.
 // - The library does no input or output on its own.  Instead, you must
 //     provide it with buffers to copy into or out of.
 
@@ -127,6 +129,34 @@
 // functions.  You can then use the get_image_data() function to retrieve the
 // currently drawn image at any time.
 //
+// By default, the canvas keeps its pixels as linear floating-point RGBA,
+// which takes 16 bytes per pixel.  If memory is tight, also
+//     #define CANVAS_ITY_COMPACT_BITMAP
+// in the implementation file to store them as premultiplied sRGB RGBA8
+// instead, at 4 bytes per pixel.  Blending then uses 16-bit integer kernels
+// and rounds to 8 bits after each draw, same as when drawing into an
+// external image.
+//
+// Shapes are scan-converted with floating point math by default.  Define
+//     #define CANVAS_ITY_FIXED_POINT
+// in the implementation file to scan-convert them in 24.8 fixed point
+// instead.  That step then uses only integer math, so it gives the same
+// coverage on every platform, such as native and WebAssembly builds, no
+// matter how the compiler treats floating point.  Long edges also convert
+// faster.  Edge crossings are rounded to 1/256th of a pixel, which changes
+// coverage by less than 1/256th of a pixel's area.
+//
+// Spans of solid color are blended with SSE2 when compiling for x86 with it
+// enabled, or with WebAssembly SIMD when compiling with -msimd128.  Define
+//     #define CANVAS_ITY_NO_SIMD
+// in the implementation file to always use the portable scalar code instead.
+//
+// On native builds with C++11 or later, you may also
+//     #define CANVAS_ITY_THREADS
+// in the implementation file and link with the platform's thread library.
+// Then calling set_thread_count() on a canvas lets it composite horizontal
+// bands of the image in parallel, with the same output as drawing serially.
+//
 // See each of the public member function and data member (i.e., method
 // and field) declarations for the full API documentation.  Also see the
 // accompanying C++ automated test suite for examples of the usage of each
@@ -167,6 +197,9 @@ enum repetition_style { repeat,
     repeat_x,
     repeat_y,
     no_repeat };
+enum filter_style { nearest,
+    bilinear,
+    bicubic };
 enum align_style { leftward,
     rightward,
     center,
@@ -202,16 +235,13 @@ struct paint_brush {
         pattern } type;
     std::vector<rgba> colors;
     std::vector<float> stops;
+    std::vector<rgba> table;
+    std::vector<bool> kinks;
     xy start, end;
     float start_radius, end_radius;
     int width, height;
     repetition_style repetition;
 };
-struct font_face {
-    std::vector<unsigned char> data;
-    int cmap, glyf, head, hhea, hmtx, loca, maxp, os_2;
-    float scale;
-};
 struct subpath_data {
     size_t count;
     bool closed;
@@ -224,11 +254,75 @@ struct line_path {
     std::vector<xy> points;
     std::vector<subpath_data> subpaths;
 };
+struct glyph_cache {
+    int glyph;
+    unsigned int last_use;
+    size_t bytes;
+    bool loaded, flattened;
+    bezier_path outline;
+    std::vector<bool> straight;
+    affine_matrix scaling;
+    float angular;
+    line_path lines;
+};
+struct font_face {
+    std::vector<unsigned char> data;
+    int cmap, glyf, head, hhea, hmtx, loca, maxp, os_2;
+    float scale;
+};
 struct pixel_run {
     unsigned short x, y;
     float delta;
 };
 typedef std::vector<pixel_run> pixel_runs;
+struct worker_pool;
+
+/// @brief  Sizes of the working buffers that a canvas renders with.
+///
+/// Each count is in elements of the corresponding buffer.  These are only
+/// meant to be read back with canvas::scratch_high_water() and passed to
+/// canvas::reserve_scratch(), or logged to tune a memory budget.
+///
+struct scratch_sizes {
+    size_t points;
+    size_t subpaths;
+    size_t runs;
+    size_t counts;
+    size_t shadow;
+};
+
+/// @brief  A path kept for drawing repeatedly.
+///
+/// Holds a copy of a path, plus the polylines and pixel coverage from the
+/// last time that it was filled and stroked, and from drawing copies of it
+/// at subpixel offsets.  See canvas::retain_path().
+///
+class retained_path {
+public:
+    retained_path();
+
+private:
+    friend class canvas;
+    struct coverage {
+        line_path lines;
+        pixel_runs runs;
+        affine_matrix transform;
+        int size_x, size_y;
+        float line_width, miter_limit, line_dash_offset;
+        cap_style line_cap;
+        join_style line_join;
+        std::vector<float> line_dash;
+        bool valid;
+        std::vector<pixel_runs> stamps;
+        std::vector<bool> stamped;
+        int origin_x, origin_y, padding;
+    };
+    bezier_path path;
+    affine_matrix forward;
+    affine_matrix inverse;
+    coverage filled;
+    coverage stroked;
+};
 
 class canvas {
 public:
@@ -249,10 +343,82 @@ public:
         int width,
         int height);
 
+    /// @brief  Construct a new canvas that draws into an existing image.
+    ///
+    /// Rather than keeping its own floating point pixel buffer, the canvas
+    /// composites straight into the given image so that there is nothing
+    /// left to copy out with get_image_data() afterwards.  The image is not
+    /// cleared; whatever it holds is the starting content of the canvas.  It
+    /// must remain valid for as long as the canvas is used.  Since each blend
+    /// is rounded back to 8 bits, results are slightly less precise than with
+    /// the internal buffer, most visibly where many translucent layers are
+    /// stacked.  The sizes must be between 1 and 32768, inclusive.
+    ///
+    /// Tip: a little-endian uint32_t 0xAABBGGRR buffer is RGBA8 in memory.
+    ///
+    /// @param width   horizontal size of the new canvas in pixels
+    /// @param height  vertical size of the new canvas in pixels
+    /// @param image   pointer to premultiplied sRGB RGBA8 image data
+    /// @param stride  number of bytes between the start of each image row
+    ///
+    canvas(
+        int width,
+        int height,
+        unsigned char* image,
+        int stride);
+
     /// @brief  Destroy the canvas and release all associated memory.
     ///
     ~canvas();
 
+    /// @brief  Set how many threads composite each drawing operation.
+    ///
+    /// The drawn shapes are split into horizontal bands of pixel rows that
+    /// are composited in parallel, by the calling thread plus a pool of
+    /// workers owned by the canvas.  Bands never share pixels, so the result
+    /// is bit-identical to drawing with a single thread.  Building the path
+    /// and shadows are still done on the calling thread alone, and small
+    /// shapes are drawn serially as splitting them would not pay off.  This
+    /// does nothing unless the implementation was compiled with
+    /// CANVAS_ITY_THREADS defined.
+    ///
+    /// @param count  number of threads to use, 1 or less to draw serially
+    ///
+    void set_thread_count(
+        int count);
+
+    /// @brief  Reserve working memory for rendering ahead of time.
+    ///
+    /// Drawing builds polylines, pixel runs, and shadow alpha in buffers
+    /// that the canvas keeps and reuses, so they only ever grow, while the
+    /// first few frames are drawn.  Reserving them up front instead lets
+    /// every frame, not just those once they settle, draw without touching
+    /// the heap.  This is mostly of interest where the heap is small and
+    /// fragments easily.  This variant estimates sizes that suffice for
+    /// drawing a few simple shapes of about the canvas size, without
+    /// shadows.  For an exact budget, draw a representative frame and pass
+    /// the result of scratch_high_water() to the other variant instead.
+    ///
+    void reserve_scratch();
+
+    /// @brief  Reserve working memory for rendering to given sizes.
+    ///
+    /// Buffers already larger than requested are left as they are.
+    ///
+    /// @param sizes  element counts to reserve for each buffer
+    ///
+    void reserve_scratch(
+        scratch_sizes const& sizes);
+
+    /// @brief  Report the most working memory that rendering has needed.
+    ///
+    /// Since the buffers are never shrunk, these are their current sizes,
+    /// including anything reserved with reserve_scratch().
+    ///
+    /// @return  element counts held for each buffer
+    ///
+    scratch_sizes scratch_high_water() const;
+
     // ======== TRANSFORMS ========
 
     /// @brief  Scale the current transform.
@@ -623,13 +789,14 @@ public:
     /// Initially, pixels in the pattern correspond exactly to pixels on the
     /// canvas, with the pattern starting in the upper left.  The pattern
     /// is affected by the current transform at the time of drawing, and
-    /// the pattern will be resampled as needed (with the filtering always
-    /// wrapping regardless of the repetition setting).  The pattern can be
-    /// repeated either horizontally, vertically, both, or neither, relative
-    /// to the source image.  If the pattern is not repeated, then beyond it
-    /// will be considered transparent black.  The pattern image, which should
-    /// be in top to bottom rows of contiguous pixels from left to right,
-    /// is copied and it is safe to change or destroy it after this call.
+    /// the pattern will be resampled as needed (with the image filter, and
+    /// always wrapping regardless of the repetition setting).  The pattern
+    /// can be repeated either horizontally, vertically, both, or neither,
+    /// relative to the source image.  If the pattern is not repeated, then
+    /// beyond it will be considered transparent black.  The pattern image,
+    /// which should be in top to bottom rows of contiguous pixels from left
+    /// to right, is copied and it is safe to change or destroy it after this
+    /// call.
     /// The width and height must both be positive.  If either are not, or
     /// the image pointer is null, this does nothing.
     ///
@@ -651,6 +818,21 @@ public:
         int stride,
         repetition_style repetition);
 
+    /// @brief  Filter for resampling patterns and images.
+    ///
+    /// Affects filling and stroking with a pattern and drawing images.  It
+    /// is looked up at the time of drawing, not when the pattern is set.
+    /// Defaults to bicubic.
+    ///
+    /// nearest:   Take the single source pixel under each sample.  Fastest,
+    ///            but blocky when magnifying and aliased when minifying.
+    /// bilinear:  Blend the two nearest source pixels along each axis, or
+    ///            average over a tent wider than that when minifying.
+    /// bicubic:   Use bicubic convolution over four source pixels along each
+    ///            axis, or correspondingly more when minifying.
+    ///
+    filter_style image_filter;
+
     // ======== BUILDING PATHS ========
 
     /// @brief  Reset the current path.
@@ -881,6 +1063,81 @@ public:
     ///
     void clip();
 
+    /// @brief  Keep a copy of the current path for drawing again later.
+    ///
+    /// The path is kept as though it had been built entirely under the
+    /// current transform.  Filling or stroking the retained path then draws
+    /// it the same as filling or stroking it as the current path would,
+    /// except that it follows any change to the transform since.  Arcs and
+    /// quadratic curves moved that way can land a rounding error away from
+    /// where building them afresh would put them.  Each time, the polylines
+    /// and the pixel coverage that they rasterize to are cached in the
+    /// retained path.  Drawing it again with the same transform, and for
+    /// strokes the same line styles, skips straight to compositing.  Use this
+    /// for static shapes that are redrawn every frame.  The current path is
+    /// left unchanged.
+    ///
+    /// @param retained  where to keep the path, replacing what it held
+    ///
+    void retain_path(
+        retained_path& retained) const;
+
+    /// @brief  Draw the interior of a retained path using the fill style.
+    ///
+    /// Same as fill(), but for a path kept by retain_path().  The current path
+    /// is not used.
+    ///
+    /// @param retained  path to draw, which keeps the results for reuse
+    ///
+    void fill(
+        retained_path& retained);
+
+    /// @brief  Draw the edges of a retained path using the stroke style.
+    ///
+    /// Same as stroke(), but for a path kept by retain_path().  The current
+    /// path is not used.
+    ///
+    /// @param retained  path to draw, which keeps the results for reuse
+    ///
+    void stroke(
+        retained_path& retained);
+
+    /// @brief  Fill many copies of a retained path at different positions.
+    ///
+    /// Draws the same as calling translate() with each position, filling the
+    /// retained path, and undoing the translation, but much faster.  The
+    /// pixel coverage of the shape is computed once for each quarter pixel
+    /// offset and then just shifted and composited for each copy, so drawing
+    /// thousands of small markers or particles costs about as much as
+    /// compositing their pixels.  In return, the position of each copy is
+    /// rounded to the nearest quarter of a canvas pixel, and since sloped
+    /// edges are scan-converted away from where the copy lands, a pixel
+    /// along one may round to a color a level off.  Shadows, if on, are still
+    /// blurred separately for each copy.  The current path is not used.
+    ///
+    /// @param retained   path to draw, which keeps the results for reuse
+    /// @param positions  x and y offsets for each copy, in pairs
+    /// @param count      number of copies to draw
+    ///
+    void fill(
+        retained_path& retained,
+        float const* positions,
+        int count);
+
+    /// @brief  Stroke many copies of a retained path at different positions.
+    ///
+    /// Same as the instanced fill() above, but stroking each copy with the
+    /// stroke style.
+    ///
+    /// @param retained   path to draw, which keeps the results for reuse
+    /// @param positions  x and y offsets for each copy, in pairs
+    /// @param count      number of copies to draw
+    ///
+    void stroke(
+        retained_path& retained,
+        float const* positions,
+        int count);
+
     /// @brief  Tests whether a point is in or on the current path.
     ///
     /// Interior areas are determined by the non-zero winding rule, with
@@ -1001,6 +1258,11 @@ public:
     /// the file.  Note that the font parsing is not meant to be secure;
     /// only use this with trusted TTF files!
     ///
+    /// Glyphs are cached as they are first drawn, up to 64 KiB per canvas.
+    /// Past that, the least recently drawn ones are dropped first.  Setting
+    /// a different font, including by restoring a saved state, empties the
+    /// cache.  Saved states do not hold a copy of it.
+    ///
     /// @param font   pointer to the contents of a TrueType font (TTF) file
     /// @param bytes  number of bytes in the font file
     /// @param size   size in pixels per em to draw at
@@ -1085,8 +1347,8 @@ public:
     ///
     /// The position of the rectangle that the image is drawn to is affected
     /// by the current transform at the time of drawing, and the image will
-    /// be resampled as needed (with the filtering always clamping to the
-    /// edges of the image).  The drawing is also affected by the shadow,
+    /// be resampled as needed (with the image filter, and always clamping to
+    /// the edges of the image).  The drawing is also affected by the shadow,
     /// global alpha, global compositing operation settings, and by the
     /// clip region.  The current path is not affected by drawing an image.
     /// The image data, which should be in top to bottom rows of contiguous
@@ -1220,15 +1482,30 @@ private:
     line_path lines;
     line_path scratch;
     pixel_runs runs;
+    pixel_runs run_buffer;
+    std::vector<unsigned int> run_counts;
     pixel_runs mask;
+    bool clipped;
     font_face face;
+    std::vector<glyph_cache> glyphs;
+    size_t glyph_bytes;
+    unsigned int glyph_uses;
     rgba* bitmap;
+    unsigned char* target;
+    int target_stride;
+    bool owns_target;
+    worker_pool* workers;
     canvas* saves;
+    canvas* spares;
     canvas(canvas const&);
     canvas& operator=(canvas const&);
+    void initialize();
     void add_tessellation(xy, xy, xy, xy, float, int);
     void add_bezier(xy, xy, xy, xy, float);
     void path_to_lines(bool);
+    void load_glyph(int, affine_matrix const&, glyph_cache&);
+    glyph_cache& cached_glyph(int);
+    void trim_glyphs(glyph_cache&);
     void add_glyph(int, float);
     int character_to_glyph(char const*, int&);
     void text_to_lines(char const*, xy, float, bool);
@@ -1236,10 +1513,22 @@ private:
     void add_half_stroke(size_t, size_t, bool);
     void stroke_lines();
     void add_runs(xy, xy);
+    void sort_runs(size_t, size_t);
     void lines_to_runs(xy, int);
     rgba paint_pixel(xy, paint_brush const&);
+    rgba read_pixel(int, int) const;
+    void write_pixel(int, int, rgba);
+    void blend_span(int, int, int, rgba, float);
     void render_shadow(paint_brush const&);
+    void render_rows(paint_brush const&, size_t, size_t, int);
+    void render_coverage(paint_brush const&);
     void render_main(paint_brush const&);
+    bool is_current(retained_path::coverage const&, bool) const;
+    void update_retained(retained_path&, retained_path::coverage&, bool);
+    void render_retained(retained_path&, retained_path::coverage&,
+        paint_brush const&, bool);
+    void render_instances(retained_path&, retained_path::coverage&,
+        paint_brush const&, bool, float const*, int);
 };
 
 }
@@ -1268,8 +1557,26 @@ private:
 #ifdef CANVAS_ITY_IMPLEMENTATION
 
 #include <algorithm>
+#include <cfloat>
 #include <cmath>
+#include <cstring>
 #include <numeric>
+#ifndef CANVAS_ITY_NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CANVAS_ITY_SSE2
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define CANVAS_ITY_SIMD128
+#endif
+#endif
+#ifdef CANVAS_ITY_THREADS
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#endif
 
 namespace canvas_ity {
 
@@ -1319,6 +1626,11 @@ static xy const operator*(affine_matrix const& left, xy right)
     return xy(left.a * right.x + left.c * right.y + left.e,
         left.b * right.x + left.d * right.y + left.f);
 }
+static bool operator==(affine_matrix const& left, affine_matrix const& right)
+{
+    return left.a == right.a && left.b == right.b && left.c == right.c &&
+        left.d == right.d && left.e == right.e && left.f == right.f;
+}
 static float dot(xy left, xy right)
 {
     return left.x * right.x + left.y * right.y;
@@ -1409,15 +1721,6 @@ static rgba const premultiplied(rgba that)
     return rgba(that.r * that.a, that.g * that.a,
         that.b * that.a, that.a);
 }
-static float delinearized(float value)
-{
-    return value < 0.0031308f ? 12.92f * value : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
-}
-static rgba const delinearized(rgba that)
-{
-    return rgba(delinearized(that.r), delinearized(that.g),
-        delinearized(that.b), that.a);
-}
 static rgba const unpremultiplied(rgba that)
 {
     static float const threshold = 1.0f / 8160.0f;
@@ -1431,6 +1734,430 @@ static rgba const clamped(rgba that)
         std::min(std::max(that.a, 0.0f), 1.0f));
 }
 
+// Lookup tables for converting between 8-bit sRGB and 16-bit linear values
+// when the pixels are stored in 8 bits, in place of the powf() calls above.
+// The delinearize table is indexed by the top 12 bits of the linear value and
+// holds the nearest sRGB value to the middle of each bucket.  That is enough
+// to resolve every 8-bit sRGB level, including those close to black, so an
+// opaque pixel survives unpacking and packing unchanged.
+//
+static unsigned short const linearize_table[256] = {
+    0, 20, 40, 60, 80, 99, 119, 139, 159, 179, 199, 219,
+    241, 264, 288, 313, 340, 367, 396, 427, 458, 491, 526, 562,
+    599, 637, 677, 718, 761, 805, 851, 898, 947, 997, 1048, 1101,
+    1156, 1212, 1270, 1330, 1391, 1453, 1517, 1583, 1651, 1720, 1790, 1863,
+    1937, 2013, 2090, 2170, 2250, 2333, 2418, 2504, 2592, 2681, 2773, 2866,
+    2961, 3058, 3157, 3258, 3360, 3464, 3570, 3678, 3788, 3900, 4014, 4129,
+    4247, 4366, 4488, 4611, 4736, 4864, 4993, 5124, 5257, 5392, 5530, 5669,
+    5810, 5953, 6099, 6246, 6395, 6547, 6700, 6856, 7014, 7174, 7335, 7500,
+    7666, 7834, 8004, 8177, 8352, 8528, 8708, 8889, 9072, 9258, 9445, 9635,
+    9828, 10022, 10219, 10417, 10619, 10822, 11028, 11235, 11446, 11658, 11873, 12090,
+    12309, 12530, 12754, 12980, 13209, 13440, 13673, 13909, 14146, 14387, 14629, 14874,
+    15122, 15371, 15623, 15878, 16135, 16394, 16656, 16920, 17187, 17456, 17727, 18001,
+    18277, 18556, 18837, 19121, 19407, 19696, 19987, 20281, 20577, 20876, 21177, 21481,
+    21787, 22096, 22407, 22721, 23038, 23357, 23678, 24002, 24329, 24658, 24990, 25325,
+    25662, 26001, 26344, 26688, 27036, 27386, 27739, 28094, 28452, 28813, 29176, 29542,
+    29911, 30282, 30656, 31033, 31412, 31794, 32179, 32567, 32957, 33350, 33745, 34143,
+    34544, 34948, 35355, 35764, 36176, 36591, 37008, 37429, 37852, 38278, 38706, 39138,
+    39572, 40009, 40449, 40891, 41337, 41785, 42236, 42690, 43147, 43606, 44069, 44534,
+    45002, 45473, 45947, 46423, 46903, 47385, 47871, 48359, 48850, 49344, 49841, 50341,
+    50844, 51349, 51858, 52369, 52884, 53401, 53921, 54445, 54971, 55500, 56032, 56567,
+    57105, 57646, 58190, 58737, 59287, 59840, 60396, 60955, 61517, 62082, 62650, 63221,
+    63795, 64372, 64952, 65535
+};
+static unsigned char const delinearize_table[4096] = {
+    0, 1, 2, 3, 4, 4, 5, 6, 7, 8, 8, 9, 10, 11, 12, 12, 13, 14, 14, 15, 16, 16, 17, 17,
+    18, 18, 19, 19, 20, 20, 21, 21, 22, 22, 23, 23, 24, 24, 24, 25, 25, 26, 26, 26, 27, 27, 28, 28,
+    28, 29, 29, 29, 30, 30, 30, 31, 31, 31, 32, 32, 32, 33, 33, 33, 34, 34, 34, 35, 35, 35, 35, 36,
+    36, 36, 37, 37, 37, 37, 38, 38, 38, 39, 39, 39, 39, 40, 40, 40, 40, 41, 41, 41, 41, 42, 42, 42,
+    42, 43, 43, 43, 43, 44, 44, 44, 44, 45, 45, 45, 45, 45, 46, 46, 46, 46, 47, 47, 47, 47, 47, 48,
+    48, 48, 48, 49, 49, 49, 49, 49, 50, 50, 50, 50, 50, 51, 51, 51, 51, 51, 52, 52, 52, 52, 52, 53,
+    53, 53, 53, 53, 54, 54, 54, 54, 54, 54, 55, 55, 55, 55, 55, 56, 56, 56, 56, 56, 56, 57, 57, 57,
+    57, 57, 58, 58, 58, 58, 58, 58, 59, 59, 59, 59, 59, 59, 60, 60, 60, 60, 60, 60, 61, 61, 61, 61,
+    61, 61, 62, 62, 62, 62, 62, 62, 63, 63, 63, 63, 63, 63, 63, 64, 64, 64, 64, 64, 64, 65, 65, 65,
+    65, 65, 65, 65, 66, 66, 66, 66, 66, 66, 66, 67, 67, 67, 67, 67, 67, 68, 68, 68, 68, 68, 68, 68,
+    69, 69, 69, 69, 69, 69, 69, 70, 70, 70, 70, 70, 70, 70, 71, 71, 71, 71, 71, 71, 71, 71, 72, 72,
+    72, 72, 72, 72, 72, 73, 73, 73, 73, 73, 73, 73, 73, 74, 74, 74, 74, 74, 74, 74, 75, 75, 75, 75,
+    75, 75, 75, 75, 76, 76, 76, 76, 76, 76, 76, 76, 77, 77, 77, 77, 77, 77, 77, 77, 78, 78, 78, 78,
+    78, 78, 78, 78, 79, 79, 79, 79, 79, 79, 79, 79, 80, 80, 80, 80, 80, 80, 80, 80, 80, 81, 81, 81,
+    81, 81, 81, 81, 81, 82, 82, 82, 82, 82, 82, 82, 82, 82, 83, 83, 83, 83, 83, 83, 83, 83, 83, 84,
+    84, 84, 84, 84, 84, 84, 84, 84, 85, 85, 85, 85, 85, 85, 85, 85, 85, 86, 86, 86, 86, 86, 86, 86,
+    86, 86, 87, 87, 87, 87, 87, 87, 87, 87, 87, 88, 88, 88, 88, 88, 88, 88, 88, 88, 89, 89, 89, 89,
+    89, 89, 89, 89, 89, 89, 90, 90, 90, 90, 90, 90, 90, 90, 90, 90, 91, 91, 91, 91, 91, 91, 91, 91,
+    91, 92, 92, 92, 92, 92, 92, 92, 92, 92, 92, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 94, 94, 94,
+    94, 94, 94, 94, 94, 94, 94, 94, 95, 95, 95, 95, 95, 95, 95, 95, 95, 95, 96, 96, 96, 96, 96, 96,
+    96, 96, 96, 96, 97, 97, 97, 97, 97, 97, 97, 97, 97, 97, 97, 98, 98, 98, 98, 98, 98, 98, 98, 98,
+    98, 98, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 100, 100, 100, 100, 100, 100, 100, 100, 100, 100, 100,
+    101, 101, 101, 101, 101, 101, 101, 101, 101, 101, 101, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 103, 103,
+    103, 103, 103, 103, 103, 103, 103, 103, 103, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 105, 105, 105,
+    105, 105, 105, 105, 105, 105, 105, 105, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 107, 107, 107, 107,
+    107, 107, 107, 107, 107, 107, 107, 107, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 109, 109, 109, 109,
+    109, 109, 109, 109, 109, 109, 109, 109, 109, 110, 110, 110, 110, 110, 110, 110, 110, 110, 110, 110, 110, 111, 111, 111,
+    111, 111, 111, 111, 111, 111, 111, 111, 111, 112, 112, 112, 112, 112, 112, 112, 112, 112, 112, 112, 112, 112, 113, 113,
+    113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114,
+    115, 115, 115, 115, 115, 115, 115, 115, 115, 115, 115, 115, 115, 116, 116, 116, 116, 116, 116, 116, 116, 116, 116, 116,
+    116, 116, 117, 117, 117, 117, 117, 117, 117, 117, 117, 117, 117, 117, 117, 118, 118, 118, 118, 118, 118, 118, 118, 118,
+    118, 118, 118, 118, 118, 119, 119, 119, 119, 119, 119, 119, 119, 119, 119, 119, 119, 119, 120, 120, 120, 120, 120, 120,
+    120, 120, 120, 120, 120, 120, 120, 120, 121, 121, 121, 121, 121, 121, 121, 121, 121, 121, 121, 121, 121, 121, 122, 122,
+    122, 122, 122, 122, 122, 122, 122, 122, 122, 122, 122, 122, 123, 123, 123, 123, 123, 123, 123, 123, 123, 123, 123, 123,
+    123, 123, 124, 124, 124, 124, 124, 124, 124, 124, 124, 124, 124, 124, 124, 124, 124, 125, 125, 125, 125, 125, 125, 125,
+    125, 125, 125, 125, 125, 125, 125, 126, 126, 126, 126, 126, 126, 126, 126, 126, 126, 126, 126, 126, 126, 126, 127, 127,
+    127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128, 128,
+    128, 128, 128, 128, 129, 129, 129, 129, 129, 129, 129, 129, 129, 129, 129, 129, 129, 129, 129, 130, 130, 130, 130, 130,
+    130, 130, 130, 130, 130, 130, 130, 130, 130, 130, 131, 131, 131, 131, 131, 131, 131, 131, 131, 131, 131, 131, 131, 131,
+    131, 132, 132, 132, 132, 132, 132, 132, 132, 132, 132, 132, 132, 132, 132, 132, 132, 133, 133, 133, 133, 133, 133, 133,
+    133, 133, 133, 133, 133, 133, 133, 133, 133, 134, 134, 134, 134, 134, 134, 134, 134, 134, 134, 134, 134, 134, 134, 134,
+    135, 135, 135, 135, 135, 135, 135, 135, 135, 135, 135, 135, 135, 135, 135, 135, 136, 136, 136, 136, 136, 136, 136, 136,
+    136, 136, 136, 136, 136, 136, 136, 136, 136, 137, 137, 137, 137, 137, 137, 137, 137, 137, 137, 137, 137, 137, 137, 137,
+    137, 138, 138, 138, 138, 138, 138, 138, 138, 138, 138, 138, 138, 138, 138, 138, 138, 139, 139, 139, 139, 139, 139, 139,
+    139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 140, 140, 140, 140, 140, 140, 140, 140, 140, 140, 140, 140, 140, 140,
+    140, 140, 140, 141, 141, 141, 141, 141, 141, 141, 141, 141, 141, 141, 141, 141, 141, 141, 141, 142, 142, 142, 142, 142,
+    142, 142, 142, 142, 142, 142, 142, 142, 142, 142, 142, 142, 142, 143, 143, 143, 143, 143, 143, 143, 143, 143, 143, 143,
+    143, 143, 143, 143, 143, 143, 144, 144, 144, 144, 144, 144, 144, 144, 144, 144, 144, 144, 144, 144, 144, 144, 144, 145,
+    145, 145, 145, 145, 145, 145, 145, 145, 145, 145, 145, 145, 145, 145, 145, 145, 145, 146, 146, 146, 146, 146, 146, 146,
+    146, 146, 146, 146, 146, 146, 146, 146, 146, 146, 147, 147, 147, 147, 147, 147, 147, 147, 147, 147, 147, 147, 147, 147,
+    147, 147, 147, 147, 148, 148, 148, 148, 148, 148, 148, 148, 148, 148, 148, 148, 148, 148, 148, 148, 148, 148, 149, 149,
+    149, 149, 149, 149, 149, 149, 149, 149, 149, 149, 149, 149, 149, 149, 149, 149, 150, 150, 150, 150, 150, 150, 150, 150,
+    150, 150, 150, 150, 150, 150, 150, 150, 150, 150, 151, 151, 151, 151, 151, 151, 151, 151, 151, 151, 151, 151, 151, 151,
+    151, 151, 151, 151, 151, 152, 152, 152, 152, 152, 152, 152, 152, 152, 152, 152, 152, 152, 152, 152, 152, 152, 152, 153,
+    153, 153, 153, 153, 153, 153, 153, 153, 153, 153, 153, 153, 153, 153, 153, 153, 153, 153, 154, 154, 154, 154, 154, 154,
+    154, 154, 154, 154, 154, 154, 154, 154, 154, 154, 154, 154, 154, 155, 155, 155, 155, 155, 155, 155, 155, 155, 155, 155,
+    155, 155, 155, 155, 155, 155, 155, 155, 156, 156, 156, 156, 156, 156, 156, 156, 156, 156, 156, 156, 156, 156, 156, 156,
+    156, 156, 156, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 158,
+    158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 159, 159, 159, 159, 159, 159,
+    159, 159, 159, 159, 159, 159, 159, 159, 159, 159, 159, 159, 159, 159, 160, 160, 160, 160, 160, 160, 160, 160, 160, 160,
+    160, 160, 160, 160, 160, 160, 160, 160, 160, 160, 161, 161, 161, 161, 161, 161, 161, 161, 161, 161, 161, 161, 161, 161,
+    161, 161, 161, 161, 161, 161, 162, 162, 162, 162, 162, 162, 162, 162, 162, 162, 162, 162, 162, 162, 162, 162, 162, 162,
+    162, 162, 163, 163, 163, 163, 163, 163, 163, 163, 163, 163, 163, 163, 163, 163, 163, 163, 163, 163, 163, 163, 164, 164,
+    164, 164, 164, 164, 164, 164, 164, 164, 164, 164, 164, 164, 164, 164, 164, 164, 164, 164, 164, 165, 165, 165, 165, 165,
+    165, 165, 165, 165, 165, 165, 165, 165, 165, 165, 165, 165, 165, 165, 165, 165, 166, 166, 166, 166, 166, 166, 166, 166,
+    166, 166, 166, 166, 166, 166, 166, 166, 166, 166, 166, 166, 167, 167, 167, 167, 167, 167, 167, 167, 167, 167, 167, 167,
+    167, 167, 167, 167, 167, 167, 167, 167, 167, 168, 168, 168, 168, 168, 168, 168, 168, 168, 168, 168, 168, 168, 168, 168,
+    168, 168, 168, 168, 168, 168, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169,
+    169, 169, 169, 169, 170, 170, 170, 170, 170, 170, 170, 170, 170, 170, 170, 170, 170, 170, 170, 170, 170, 170, 170, 170,
+    170, 171, 171, 171, 171, 171, 171, 171, 171, 171, 171, 171, 171, 171, 171, 171, 171, 171, 171, 171, 171, 171, 171, 172,
+    172, 172, 172, 172, 172, 172, 172, 172, 172, 172, 172, 172, 172, 172, 172, 172, 172, 172, 172, 172, 172, 173, 173, 173,
+    173, 173, 173, 173, 173, 173, 173, 173, 173, 173, 173, 173, 173, 173, 173, 173, 173, 173, 173, 174, 174, 174, 174, 174,
+    174, 174, 174, 174, 174, 174, 174, 174, 174, 174, 174, 174, 174, 174, 174, 174, 174, 175, 175, 175, 175, 175, 175, 175,
+    175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 176, 176, 176, 176, 176, 176, 176, 176, 176,
+    176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177,
+    177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 178, 178, 178, 178, 178, 178, 178, 178, 178, 178, 178, 178,
+    178, 178, 178, 178, 178, 178, 178, 178, 178, 178, 178, 179, 179, 179, 179, 179, 179, 179, 179, 179, 179, 179, 179, 179,
+    179, 179, 179, 179, 179, 179, 179, 179, 179, 179, 180, 180, 180, 180, 180, 180, 180, 180, 180, 180, 180, 180, 180, 180,
+    180, 180, 180, 180, 180, 180, 180, 180, 180, 181, 181, 181, 181, 181, 181, 181, 181, 181, 181, 181, 181, 181, 181, 181,
+    181, 181, 181, 181, 181, 181, 181, 181, 182, 182, 182, 182, 182, 182, 182, 182, 182, 182, 182, 182, 182, 182, 182, 182,
+    182, 182, 182, 182, 182, 182, 182, 182, 183, 183, 183, 183, 183, 183, 183, 183, 183, 183, 183, 183, 183, 183, 183, 183,
+    183, 183, 183, 183, 183, 183, 183, 184, 184, 184, 184, 184, 184, 184, 184, 184, 184, 184, 184, 184, 184, 184, 184, 184,
+    184, 184, 184, 184, 184, 184, 184, 185, 185, 185, 185, 185, 185, 185, 185, 185, 185, 185, 185, 185, 185, 185, 185, 185,
+    185, 185, 185, 185, 185, 185, 185, 186, 186, 186, 186, 186, 186, 186, 186, 186, 186, 186, 186, 186, 186, 186, 186, 186,
+    186, 186, 186, 186, 186, 186, 186, 187, 187, 187, 187, 187, 187, 187, 187, 187, 187, 187, 187, 187, 187, 187, 187, 187,
+    187, 187, 187, 187, 187, 187, 187, 187, 188, 188, 188, 188, 188, 188, 188, 188, 188, 188, 188, 188, 188, 188, 188, 188,
+    188, 188, 188, 188, 188, 188, 188, 188, 189, 189, 189, 189, 189, 189, 189, 189, 189, 189, 189, 189, 189, 189, 189, 189,
+    189, 189, 189, 189, 189, 189, 189, 189, 189, 190, 190, 190, 190, 190, 190, 190, 190, 190, 190, 190, 190, 190, 190, 190,
+    190, 190, 190, 190, 190, 190, 190, 190, 190, 190, 191, 191, 191, 191, 191, 191, 191, 191, 191, 191, 191, 191, 191, 191,
+    191, 191, 191, 191, 191, 191, 191, 191, 191, 191, 191, 192, 192, 192, 192, 192, 192, 192, 192, 192, 192, 192, 192, 192,
+    192, 192, 192, 192, 192, 192, 192, 192, 192, 192, 192, 192, 193, 193, 193, 193, 193, 193, 193, 193, 193, 193, 193, 193,
+    193, 193, 193, 193, 193, 193, 193, 193, 193, 193, 193, 193, 193, 194, 194, 194, 194, 194, 194, 194, 194, 194, 194, 194,
+    194, 194, 194, 194, 194, 194, 194, 194, 194, 194, 194, 194, 194, 194, 195, 195, 195, 195, 195, 195, 195, 195, 195, 195,
+    195, 195, 195, 195, 195, 195, 195, 195, 195, 195, 195, 195, 195, 195, 195, 195, 196, 196, 196, 196, 196, 196, 196, 196,
+    196, 196, 196, 196, 196, 196, 196, 196, 196, 196, 196, 196, 196, 196, 196, 196, 196, 196, 197, 197, 197, 197, 197, 197,
+    197, 197, 197, 197, 197, 197, 197, 197, 197, 197, 197, 197, 197, 197, 197, 197, 197, 197, 197, 197, 198, 198, 198, 198,
+    198, 198, 198, 198, 198, 198, 198, 198, 198, 198, 198, 198, 198, 198, 198, 198, 198, 198, 198, 198, 198, 198, 199, 199,
+    199, 199, 199, 199, 199, 199, 199, 199, 199, 199, 199, 199, 199, 199, 199, 199, 199, 199, 199, 199, 199, 199, 199, 199,
+    199, 200, 200, 200, 200, 200, 200, 200, 200, 200, 200, 200, 200, 200, 200, 200, 200, 200, 200, 200, 200, 200, 200, 200,
+    200, 200, 200, 201, 201, 201, 201, 201, 201, 201, 201, 201, 201, 201, 201, 201, 201, 201, 201, 201, 201, 201, 201, 201,
+    201, 201, 201, 201, 201, 201, 202, 202, 202, 202, 202, 202, 202, 202, 202, 202, 202, 202, 202, 202, 202, 202, 202, 202,
+    202, 202, 202, 202, 202, 202, 202, 202, 202, 203, 203, 203, 203, 203, 203, 203, 203, 203, 203, 203, 203, 203, 203, 203,
+    203, 203, 203, 203, 203, 203, 203, 203, 203, 203, 203, 203, 204, 204, 204, 204, 204, 204, 204, 204, 204, 204, 204, 204,
+    204, 204, 204, 204, 204, 204, 204, 204, 204, 204, 204, 204, 204, 204, 204, 205, 205, 205, 205, 205, 205, 205, 205, 205,
+    205, 205, 205, 205, 205, 205, 205, 205, 205, 205, 205, 205, 205, 205, 205, 205, 205, 205, 206, 206, 206, 206, 206, 206,
+    206, 206, 206, 206, 206, 206, 206, 206, 206, 206, 206, 206, 206, 206, 206, 206, 206, 206, 206, 206, 206, 206, 207, 207,
+    207, 207, 207, 207, 207, 207, 207, 207, 207, 207, 207, 207, 207, 207, 207, 207, 207, 207, 207, 207, 207, 207, 207, 207,
+    207, 207, 208, 208, 208, 208, 208, 208, 208, 208, 208, 208, 208, 208, 208, 208, 208, 208, 208, 208, 208, 208, 208, 208,
+    208, 208, 208, 208, 208, 208, 209, 209, 209, 209, 209, 209, 209, 209, 209, 209, 209, 209, 209, 209, 209, 209, 209, 209,
+    209, 209, 209, 209, 209, 209, 209, 209, 209, 209, 210, 210, 210, 210, 210, 210, 210, 210, 210, 210, 210, 210, 210, 210,
+    210, 210, 210, 210, 210, 210, 210, 210, 210, 210, 210, 210, 210, 210, 211, 211, 211, 211, 211, 211, 211, 211, 211, 211,
+    211, 211, 211, 211, 211, 211, 211, 211, 211, 211, 211, 211, 211, 211, 211, 211, 211, 211, 212, 212, 212, 212, 212, 212,
+    212, 212, 212, 212, 212, 212, 212, 212, 212, 212, 212, 212, 212, 212, 212, 212, 212, 212, 212, 212, 212, 212, 212, 213,
+    213, 213, 213, 213, 213, 213, 213, 213, 213, 213, 213, 213, 213, 213, 213, 213, 213, 213, 213, 213, 213, 213, 213, 213,
+    213, 213, 213, 213, 214, 214, 214, 214, 214, 214, 214, 214, 214, 214, 214, 214, 214, 214, 214, 214, 214, 214, 214, 214,
+    214, 214, 214, 214, 214, 214, 214, 214, 214, 215, 215, 215, 215, 215, 215, 215, 215, 215, 215, 215, 215, 215, 215, 215,
+    215, 215, 215, 215, 215, 215, 215, 215, 215, 215, 215, 215, 215, 215, 216, 216, 216, 216, 216, 216, 216, 216, 216, 216,
+    216, 216, 216, 216, 216, 216, 216, 216, 216, 216, 216, 216, 216, 216, 216, 216, 216, 216, 216, 217, 217, 217, 217, 217,
+    217, 217, 217, 217, 217, 217, 217, 217, 217, 217, 217, 217, 217, 217, 217, 217, 217, 217, 217, 217, 217, 217, 217, 217,
+    217, 218, 218, 218, 218, 218, 218, 218, 218, 218, 218, 218, 218, 218, 218, 218, 218, 218, 218, 218, 218, 218, 218, 218,
+    218, 218, 218, 218, 218, 218, 218, 219, 219, 219, 219, 219, 219, 219, 219, 219, 219, 219, 219, 219, 219, 219, 219, 219,
+    219, 219, 219, 219, 219, 219, 219, 219, 219, 219, 219, 219, 220, 220, 220, 220, 220, 220, 220, 220, 220, 220, 220, 220,
+    220, 220, 220, 220, 220, 220, 220, 220, 220, 220, 220, 220, 220, 220, 220, 220, 220, 220, 220, 221, 221, 221, 221, 221,
+    221, 221, 221, 221, 221, 221, 221, 221, 221, 221, 221, 221, 221, 221, 221, 221, 221, 221, 221, 221, 221, 221, 221, 221,
+    221, 222, 222, 222, 222, 222, 222, 222, 222, 222, 222, 222, 222, 222, 222, 222, 222, 222, 222, 222, 222, 222, 222, 222,
+    222, 222, 222, 222, 222, 222, 222, 223, 223, 223, 223, 223, 223, 223, 223, 223, 223, 223, 223, 223, 223, 223, 223, 223,
+    223, 223, 223, 223, 223, 223, 223, 223, 223, 223, 223, 223, 223, 223, 224, 224, 224, 224, 224, 224, 224, 224, 224, 224,
+    224, 224, 224, 224, 224, 224, 224, 224, 224, 224, 224, 224, 224, 224, 224, 224, 224, 224, 224, 224, 224, 225, 225, 225,
+    225, 225, 225, 225, 225, 225, 225, 225, 225, 225, 225, 225, 225, 225, 225, 225, 225, 225, 225, 225, 225, 225, 225, 225,
+    225, 225, 225, 225, 226, 226, 226, 226, 226, 226, 226, 226, 226, 226, 226, 226, 226, 226, 226, 226, 226, 226, 226, 226,
+    226, 226, 226, 226, 226, 226, 226, 226, 226, 226, 226, 227, 227, 227, 227, 227, 227, 227, 227, 227, 227, 227, 227, 227,
+    227, 227, 227, 227, 227, 227, 227, 227, 227, 227, 227, 227, 227, 227, 227, 227, 227, 227, 228, 228, 228, 228, 228, 228,
+    228, 228, 228, 228, 228, 228, 228, 228, 228, 228, 228, 228, 228, 228, 228, 228, 228, 228, 228, 228, 228, 228, 228, 228,
+    228, 228, 229, 229, 229, 229, 229, 229, 229, 229, 229, 229, 229, 229, 229, 229, 229, 229, 229, 229, 229, 229, 229, 229,
+    229, 229, 229, 229, 229, 229, 229, 229, 229, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230,
+    230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 231, 231, 231, 231, 231, 231, 231,
+    231, 231, 231, 231, 231, 231, 231, 231, 231, 231, 231, 231, 231, 231, 231, 231, 231, 231, 231, 231, 231, 231, 231, 231,
+    231, 232, 232, 232, 232, 232, 232, 232, 232, 232, 232, 232, 232, 232, 232, 232, 232, 232, 232, 232, 232, 232, 232, 232,
+    232, 232, 232, 232, 232, 232, 232, 232, 232, 233, 233, 233, 233, 233, 233, 233, 233, 233, 233, 233, 233, 233, 233, 233,
+    233, 233, 233, 233, 233, 233, 233, 233, 233, 233, 233, 233, 233, 233, 233, 233, 233, 233, 234, 234, 234, 234, 234, 234,
+    234, 234, 234, 234, 234, 234, 234, 234, 234, 234, 234, 234, 234, 234, 234, 234, 234, 234, 234, 234, 234, 234, 234, 234,
+    234, 234, 235, 235, 235, 235, 235, 235, 235, 235, 235, 235, 235, 235, 235, 235, 235, 235, 235, 235, 235, 235, 235, 235,
+    235, 235, 235, 235, 235, 235, 235, 235, 235, 235, 235, 236, 236, 236, 236, 236, 236, 236, 236, 236, 236, 236, 236, 236,
+    236, 236, 236, 236, 236, 236, 236, 236, 236, 236, 236, 236, 236, 236, 236, 236, 236, 236, 236, 236, 237, 237, 237, 237,
+    237, 237, 237, 237, 237, 237, 237, 237, 237, 237, 237, 237, 237, 237, 237, 237, 237, 237, 237, 237, 237, 237, 237, 237,
+    237, 237, 237, 237, 237, 238, 238, 238, 238, 238, 238, 238, 238, 238, 238, 238, 238, 238, 238, 238, 238, 238, 238, 238,
+    238, 238, 238, 238, 238, 238, 238, 238, 238, 238, 238, 238, 238, 238, 238, 239, 239, 239, 239, 239, 239, 239, 239, 239,
+    239, 239, 239, 239, 239, 239, 239, 239, 239, 239, 239, 239, 239, 239, 239, 239, 239, 239, 239, 239, 239, 239, 239, 239,
+    240, 240, 240, 240, 240, 240, 240, 240, 240, 240, 240, 240, 240, 240, 240, 240, 240, 240, 240, 240, 240, 240, 240, 240,
+    240, 240, 240, 240, 240, 240, 240, 240, 240, 240, 241, 241, 241, 241, 241, 241, 241, 241, 241, 241, 241, 241, 241, 241,
+    241, 241, 241, 241, 241, 241, 241, 241, 241, 241, 241, 241, 241, 241, 241, 241, 241, 241, 241, 241, 242, 242, 242, 242,
+    242, 242, 242, 242, 242, 242, 242, 242, 242, 242, 242, 242, 242, 242, 242, 242, 242, 242, 242, 242, 242, 242, 242, 242,
+    242, 242, 242, 242, 242, 242, 243, 243, 243, 243, 243, 243, 243, 243, 243, 243, 243, 243, 243, 243, 243, 243, 243, 243,
+    243, 243, 243, 243, 243, 243, 243, 243, 243, 243, 243, 243, 243, 243, 243, 243, 244, 244, 244, 244, 244, 244, 244, 244,
+    244, 244, 244, 244, 244, 244, 244, 244, 244, 244, 244, 244, 244, 244, 244, 244, 244, 244, 244, 244, 244, 244, 244, 244,
+    244, 244, 244, 245, 245, 245, 245, 245, 245, 245, 245, 245, 245, 245, 245, 245, 245, 245, 245, 245, 245, 245, 245, 245,
+    245, 245, 245, 245, 245, 245, 245, 245, 245, 245, 245, 245, 245, 246, 246, 246, 246, 246, 246, 246, 246, 246, 246, 246,
+    246, 246, 246, 246, 246, 246, 246, 246, 246, 246, 246, 246, 246, 246, 246, 246, 246, 246, 246, 246, 246, 246, 246, 246,
+    247, 247, 247, 247, 247, 247, 247, 247, 247, 247, 247, 247, 247, 247, 247, 247, 247, 247, 247, 247, 247, 247, 247, 247,
+    247, 247, 247, 247, 247, 247, 247, 247, 247, 247, 247, 248, 248, 248, 248, 248, 248, 248, 248, 248, 248, 248, 248, 248,
+    248, 248, 248, 248, 248, 248, 248, 248, 248, 248, 248, 248, 248, 248, 248, 248, 248, 248, 248, 248, 248, 248, 249, 249,
+    249, 249, 249, 249, 249, 249, 249, 249, 249, 249, 249, 249, 249, 249, 249, 249, 249, 249, 249, 249, 249, 249, 249, 249,
+    249, 249, 249, 249, 249, 249, 249, 249, 249, 249, 250, 250, 250, 250, 250, 250, 250, 250, 250, 250, 250, 250, 250, 250,
+    250, 250, 250, 250, 250, 250, 250, 250, 250, 250, 250, 250, 250, 250, 250, 250, 250, 250, 250, 250, 250, 251, 251, 251,
+    251, 251, 251, 251, 251, 251, 251, 251, 251, 251, 251, 251, 251, 251, 251, 251, 251, 251, 251, 251, 251, 251, 251, 251,
+    251, 251, 251, 251, 251, 251, 251, 251, 251, 252, 252, 252, 252, 252, 252, 252, 252, 252, 252, 252, 252, 252, 252, 252,
+    252, 252, 252, 252, 252, 252, 252, 252, 252, 252, 252, 252, 252, 252, 252, 252, 252, 252, 252, 252, 252, 253, 253, 253,
+    253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253, 253,
+    253, 253, 253, 253, 253, 253, 253, 253, 253, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254,
+    254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 254, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255
+};
+
+// Table driven conversions for moving whole images in and out of the canvas,
+// where calling powf() for every channel of every pixel dominates.  Unpacking
+// 8-bit sRGB is a direct lookup in the linearize table above.  Going the other
+// way, the curve is tabulated against the square root of the linear value,
+// where it is nearly straight, so interpolating between 257 samples stays
+// within 0.013 of an 8-bit level of the exact curve everywhere.  Colors set
+// individually through set_color() and add_color_stop() still use the exact
+// linearized() above.
+//
+static float const delinearize_curve[257] = {
+    0.000000000f, 0.000197144f, 0.000788574f, 0.001774292f, 0.003154297f, 0.004928589f,
+    0.007097168f, 0.009660034f, 0.012617187f, 0.015968628f, 0.019714355f, 0.023854370f,
+    0.028388672f, 0.033317261f, 0.038640137f, 0.044188625f, 0.049669257f, 0.055093055f,
+    0.060463905f, 0.065785228f, 0.071060053f, 0.076291084f, 0.081480746f, 0.086631227f,
+    0.091744508f, 0.096822392f, 0.101866526f, 0.106878421f, 0.111859465f, 0.116810942f,
+    0.121734038f, 0.126629854f, 0.131499414f, 0.136343672f, 0.141163523f, 0.145959801f,
+    0.150733291f, 0.155484729f, 0.160214809f, 0.164924187f, 0.169613479f, 0.174283271f,
+    0.178934117f, 0.183566542f, 0.188181044f, 0.192778099f, 0.197358158f, 0.201921651f,
+    0.206468988f, 0.211000563f, 0.215516749f, 0.220017904f, 0.224504374f, 0.228976485f,
+    0.233434555f, 0.237878885f, 0.242309768f, 0.246727482f, 0.251132297f, 0.255524472f,
+    0.259904256f, 0.264271891f, 0.268627608f, 0.272971631f, 0.277304177f, 0.281625454f,
+    0.285935665f, 0.290235005f, 0.294523662f, 0.298801821f, 0.303069658f, 0.307327346f,
+    0.311575050f, 0.315812932f, 0.320041150f, 0.324259855f, 0.328469195f, 0.332669314f,
+    0.336860352f, 0.341042443f, 0.345215721f, 0.349380313f, 0.353536345f, 0.357683937f,
+    0.361823210f, 0.365954277f, 0.370077252f, 0.374192245f, 0.378299361f, 0.382398706f,
+    0.386490382f, 0.390574487f, 0.394651118f, 0.398720371f, 0.402782338f, 0.406837109f,
+    0.410884773f, 0.414925415f, 0.418959121f, 0.422985972f, 0.427006049f, 0.431019432f,
+    0.435026197f, 0.439026421f, 0.443020177f, 0.447007537f, 0.450988574f, 0.454963355f,
+    0.458931951f, 0.462894426f, 0.466850847f, 0.470801278f, 0.474745782f, 0.478684420f,
+    0.482617254f, 0.486544341f, 0.490465742f, 0.494381512f, 0.498291708f, 0.502196384f,
+    0.506095596f, 0.509989396f, 0.513877837f, 0.517760968f, 0.521638842f, 0.525511507f,
+    0.529379012f, 0.533241404f, 0.537098730f, 0.540951038f, 0.544798371f, 0.548640775f,
+    0.552478294f, 0.556310970f, 0.560138846f, 0.563961965f, 0.567780366f, 0.571594090f,
+    0.575403178f, 0.579207668f, 0.583007599f, 0.586803009f, 0.590593936f, 0.594380415f,
+    0.598162484f, 0.601940178f, 0.605713532f, 0.609482581f, 0.613247360f, 0.617007900f,
+    0.620764237f, 0.624516403f, 0.628264429f, 0.632008348f, 0.635748191f, 0.639483988f,
+    0.643215770f, 0.646943568f, 0.650667410f, 0.654387327f, 0.658103346f, 0.661815496f,
+    0.665523805f, 0.669228301f, 0.672929012f, 0.676625963f, 0.680319182f, 0.684008694f,
+    0.687694527f, 0.691376704f, 0.695055252f, 0.698730195f, 0.702401558f, 0.706069366f,
+    0.709733641f, 0.713394408f, 0.717051691f, 0.720705511f, 0.724355893f, 0.728002859f,
+    0.731646430f, 0.735286629f, 0.738923478f, 0.742556998f, 0.746187210f, 0.749814135f,
+    0.753437795f, 0.757058208f, 0.760675397f, 0.764289380f, 0.767900177f, 0.771507809f,
+    0.775112294f, 0.778713651f, 0.782311900f, 0.785907059f, 0.789499146f, 0.793088180f,
+    0.796674179f, 0.800257160f, 0.803837142f, 0.807414142f, 0.810988178f, 0.814559265f,
+    0.818127422f, 0.821692665f, 0.825255010f, 0.828814474f, 0.832371074f, 0.835924825f,
+    0.839475743f, 0.843023844f, 0.846569143f, 0.850111657f, 0.853651399f, 0.857188386f,
+    0.860722632f, 0.864254152f, 0.867782961f, 0.871309072f, 0.874832502f, 0.878353263f,
+    0.881871370f, 0.885386836f, 0.888899676f, 0.892409904f, 0.895917532f, 0.899422574f,
+    0.902925044f, 0.906424955f, 0.909922319f, 0.913417150f, 0.916909460f, 0.920399262f,
+    0.923886569f, 0.927371393f, 0.930853746f, 0.934333641f, 0.937811089f, 0.941286103f,
+    0.944758695f, 0.948228876f, 0.951696658f, 0.955162052f, 0.958625071f, 0.962085725f,
+    0.965544025f, 0.968999983f, 0.972453610f, 0.975904917f, 0.979353915f, 0.982800614f,
+    0.986245025f, 0.989687158f, 0.993127025f, 0.996564636f, 1.000000000f
+};
+static rgba const linearized(unsigned char const* pixel)
+{
+    return rgba(linearize_table[pixel[0]] / 65535.0f,
+        linearize_table[pixel[1]] / 65535.0f,
+        linearize_table[pixel[2]] / 65535.0f,
+        pixel[3] / 255.0f);
+}
+static float delinearized(float value)
+{
+    float place = sqrtf(value) * 256.0f;
+    int index = std::min(static_cast<int>(place), 255);
+    float left = delinearize_curve[index];
+    return left + (place - static_cast<float>(index)) *
+        (delinearize_curve[index + 1] - left);
+}
+static rgba const delinearized(rgba that)
+{
+    return rgba(delinearized(that.r), delinearized(that.g),
+        delinearized(that.b), that.a);
+}
+
+// Unpack a premultiplied sRGB RGBA8 pixel into premultiplied linear 16-bit
+// channels, and pack such channels back with rounding.  Alpha is linear to
+// begin with, so only the color channels go through the tables, which means
+// they must be unpremultiplied on the way.  The remaining helpers multiply
+// two such 16-bit values with the result rounded and rescaled to 16 bits
+// without a division, and convert from floats with clamping.  The signed
+// forms carry the overshoot of the bicubic filter past zero through a blend,
+// where clamping it early would lighten the pixels it should darken.
+//
+static void unpack_pixel(
+    unsigned char const* pixel,
+    unsigned int* channels)
+{
+    unsigned int alpha = pixel[3];
+    channels[3] = alpha * 257;
+    if (alpha == 255) {
+        channels[0] = linearize_table[pixel[0]];
+        channels[1] = linearize_table[pixel[1]];
+        channels[2] = linearize_table[pixel[2]];
+        return;
+    }
+    if (alpha == 0) {
+        channels[0] = channels[1] = channels[2] = 0;
+        return;
+    }
+    unsigned int reciprocal = (255u << 16) / alpha;
+    for (int index = 0; index < 3; ++index) {
+        unsigned int straight = std::min((pixel[index] * reciprocal + 32768u) >> 16, 255u);
+        channels[index] = (linearize_table[straight] * alpha + 127) / 255;
+    }
+}
+static void pack_pixel(
+    unsigned int const* channels,
+    unsigned char* pixel)
+{
+    unsigned int alpha = (channels[3] * 255 + 32767) / 65535;
+    pixel[3] = static_cast<unsigned char>(alpha);
+    if (channels[3] == 65535) {
+        pixel[0] = delinearize_table[channels[0] >> 4];
+        pixel[1] = delinearize_table[channels[1] >> 4];
+        pixel[2] = delinearize_table[channels[2] >> 4];
+        return;
+    }
+    if (alpha == 0) {
+        pixel[0] = pixel[1] = pixel[2] = 0;
+        return;
+    }
+    unsigned int reciprocal = (65535u << 15) / channels[3];
+    for (int index = 0; index < 3; ++index) {
+        unsigned int straight = std::min(channels[index], channels[3]) * reciprocal >> 15;
+        pixel[index] = static_cast<unsigned char>(
+            (delinearize_table[std::min(straight, 65535u) >> 4] * alpha + 127) / 255);
+    }
+}
+static unsigned int multiplied(
+    unsigned int left,
+    unsigned int right)
+{
+    unsigned int product = left * right + 32768;
+    return (product + (product >> 16)) >> 16;
+}
+static unsigned int quantized(
+    float value)
+{
+    int scaled = static_cast<int>(std::min(value, 1.0f) * 65535.0f + 0.5f);
+    return static_cast<unsigned int>(std::max(scaled, 0));
+}
+static int signed_quantized(
+    float value)
+{
+    float scaled = std::min(std::max(value, -1.0f), 1.0f) * 65535.0f;
+    return static_cast<int>(scaled < 0.0f ? scaled - 0.5f : scaled + 0.5f);
+}
+static int signed_multiplied(
+    unsigned int left,
+    int right)
+{
+    int product = static_cast<int>(multiplied(
+        left, static_cast<unsigned int>(right < 0 ? -right : right)));
+    return right < 0 ? -product : product;
+}
+static void quantized(
+    rgba that,
+    unsigned int* channels)
+{
+    channels[0] = quantized(that.r);
+    channels[1] = quantized(that.g);
+    channels[2] = quantized(that.b);
+    channels[3] = quantized(that.a);
+}
+
+// Minimal wrappers over the vector instructions used for blending spans, so
+// that the kernels below are written once for either instruction set.  Each
+// vector holds the four float channels of one pixel, or four packed RGBA8
+// pixels for the integer fill.
+//
+#if defined(CANVAS_ITY_SSE2)
+typedef __m128 lanes;
+static lanes lanes_load(float const* from) { return _mm_loadu_ps(from); }
+static void lanes_store(float* to, lanes that) { _mm_storeu_ps(to, that); }
+static lanes lanes_splat(float value) { return _mm_set1_ps(value); }
+static lanes lanes_set(float r, float g, float b, float a) { return _mm_setr_ps(r, g, b, a); }
+static lanes lanes_alpha(lanes that) { return _mm_shuffle_ps(that, that, _MM_SHUFFLE(3, 3, 3, 3)); }
+static lanes lanes_add(lanes left, lanes right) { return _mm_add_ps(left, right); }
+static lanes lanes_mul(lanes left, lanes right) { return _mm_mul_ps(left, right); }
+static lanes lanes_min(lanes left, lanes right) { return _mm_min_ps(left, right); }
+static void fill_pixels(unsigned char* to, unsigned char const* pixel, int count)
+{
+    int packed;
+    memcpy(&packed, pixel, 4);
+    __m128i quad = _mm_set1_epi32(packed);
+    for (; count >= 4; count -= 4, to += 16)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(to), quad);
+    for (; count > 0; --count, to += 4)
+        memcpy(to, pixel, 4);
+}
+#elif defined(CANVAS_ITY_SIMD128)
+typedef v128_t lanes;
+static lanes lanes_load(float const* from) { return wasm_v128_load(from); }
+static void lanes_store(float* to, lanes that) { wasm_v128_store(to, that); }
+static lanes lanes_splat(float value) { return wasm_f32x4_splat(value); }
+static lanes lanes_set(float r, float g, float b, float a) { return wasm_f32x4_make(r, g, b, a); }
+static lanes lanes_alpha(lanes that) { return wasm_i32x4_shuffle(that, that, 3, 3, 3, 3); }
+static lanes lanes_add(lanes left, lanes right) { return wasm_f32x4_add(left, right); }
+static lanes lanes_mul(lanes left, lanes right) { return wasm_f32x4_mul(left, right); }
+static lanes lanes_min(lanes left, lanes right) { return wasm_f32x4_pmin(left, right); }
+static void fill_pixels(unsigned char* to, unsigned char const* pixel, int count)
+{
+    int packed;
+    memcpy(&packed, pixel, 4);
+    v128_t quad = wasm_i32x4_splat(packed);
+    for (; count >= 4; count -= 4, to += 16)
+        wasm_v128_store(to, quad);
+    for (; count > 0; --count, to += 4)
+        memcpy(to, pixel, 4);
+}
+#else
+static void fill_pixels(unsigned char* to, unsigned char const* pixel, int count)
+{
+    for (; count > 0; --count, to += 4)
+        memcpy(to, pixel, 4);
+}
+#endif
+
 // Helpers for TTF file parsing
 static int unsigned_8(std::vector<unsigned char>& data, int index)
 {
@@ -1647,16 +2374,18 @@ void canvas::path_to_lines(
     }
 }
 
-// Add a text glyph directly to the polylines.  Given a glyph index, this
-// parses the data for that glyph directly from the TTF glyph data table and
-// immediately tessellates it to a set of a polyline subpaths which it adds
-// to any subpaths already present.  It uses the current transform matrix to
-// transform from the glyph's vertices in font units to the proper size and
-// position on the canvas.
+// Load the outline of a text glyph into the glyph cache.  Given a glyph
+// index, this parses the data for that glyph directly from the TTF glyph data
+// table and converts its contours of quadratic curves and straight lines into
+// closed subpaths of cubic Beziers, remembering which segments are straight.
+// The placement matrix maps from the glyph's vertices in font units to those
+// of the glyph being loaded, which only differ for the components of a
+// composite glyph.  These are loaded recursively and appended.
 //
-void canvas::add_glyph(
+void canvas::load_glyph(
     int glyph,
-    float angular)
+    affine_matrix const& placement,
+    glyph_cache& into)
 {
     int loc_format = unsigned_16(face.data, face.head + 50);
     int offset = face.glyf + (loc_format ? signed_32(face.data, face.loca + glyph * 4) : unsigned_16(face.data, face.loca + glyph * 2) * 2);
@@ -1692,12 +2421,15 @@ void canvas::add_glyph(
             offset += flags & 8 ? 2 : flags & 64 ? 4
                 : flags & 128                    ? 8
                                                  : 0;
-            affine_matrix saved_forward = forward;
-            affine_matrix saved_inverse = inverse;
-            transform(a, b, c, d, e, f);
-            add_glyph(component, angular);
-            forward = saved_forward;
-            inverse = saved_inverse;
+            affine_matrix component_placement = {
+                placement.a * a + placement.c * b,
+                placement.b * a + placement.d * b,
+                placement.a * c + placement.c * d,
+                placement.b * c + placement.d * d,
+                placement.a * e + placement.c * f + placement.e,
+                placement.b * e + placement.d * f + placement.f
+            };
+            load_glyph(component, component_placement, into);
             if (!(flags & 32))
                 return;
         }
@@ -1724,6 +2456,7 @@ void canvas::add_glyph(
     int flags = 0;
     int repeated = 0;
     int index = 0;
+    std::vector<xy>& outline = into.outline.points;
     for (int contour = 0; contour < contours; ++contour) {
         int beginning = index;
         int ending = unsigned_16(face.data, offset + 10 + contour * 2);
@@ -1731,7 +2464,7 @@ void canvas::add_glyph(
         bool begin_on = false;
         xy end_point = xy(0.0f, 0.0f);
         bool end_on = false;
-        size_t first = lines.points.size();
+        size_t first = outline.size();
         for (; index <= ending; ++index) {
             if (repeated)
                 --repeated;
@@ -1752,52 +2485,195 @@ void canvas::add_glyph(
                                                   : 2;
             y_array += flags & 4 ? 1 : flags & 32 ? 0
                                                   : 2;
-            xy point = forward * xy(static_cast<float>(x), static_cast<float>(y));
+            xy point = placement * xy(static_cast<float>(x), static_cast<float>(y));
             int on_curve = flags & 1;
             if (index == beginning) {
                 begin_point = point;
                 begin_on = on_curve;
                 if (on_curve)
-                    lines.points.push_back(point);
+                    outline.push_back(point);
             } else {
                 xy point_2 = on_curve ? point : lerp(end_point, point, 0.5f);
-                if (lines.points.size() == first || (end_on && on_curve))
-                    lines.points.push_back(point_2);
-                else if (!end_on || on_curve) {
-                    xy point_1 = lines.points.back();
-                    xy control_1 = lerp(point_1, end_point, 2.0f / 3.0f);
-                    xy control_2 = lerp(point_2, end_point, 2.0f / 3.0f);
-                    add_bezier(point_1, control_1, control_2, point_2,
-                        angular);
+                if (outline.size() == first)
+                    outline.push_back(point_2);
+                else if (end_on && on_curve) {
+                    outline.insert(outline.end(), 3, point_2);
+                    into.straight.push_back(true);
+                } else if (!end_on || on_curve) {
+                    xy point_1 = outline.back();
+                    outline.push_back(lerp(point_1, end_point, 2.0f / 3.0f));
+                    outline.push_back(lerp(point_2, end_point, 2.0f / 3.0f));
+                    outline.push_back(point_2);
+                    into.straight.push_back(false);
                 }
             }
             end_point = point;
             end_on = on_curve;
         }
+        if (outline.size() == first)
+            continue;
         if (begin_on ^ end_on) {
-            xy point_1 = lines.points.back();
-            xy point_2 = lines.points[first];
+            xy point_1 = outline.back();
+            xy point_2 = outline[first];
             xy control = end_on ? begin_point : end_point;
-            xy control_1 = lerp(point_1, control, 2.0f / 3.0f);
-            xy control_2 = lerp(point_2, control, 2.0f / 3.0f);
-            add_bezier(point_1, control_1, control_2, point_2, angular);
+            outline.push_back(lerp(point_1, control, 2.0f / 3.0f));
+            outline.push_back(lerp(point_2, control, 2.0f / 3.0f));
+            outline.push_back(point_2);
+            into.straight.push_back(false);
         } else if (!begin_on && !end_on) {
-            xy point_1 = lines.points.back();
+            xy point_1 = outline.back();
             xy split = lerp(begin_point, end_point, 0.5f);
-            xy point_2 = lines.points[first];
-            xy left_1 = lerp(point_1, end_point, 2.0f / 3.0f);
-            xy left_2 = lerp(split, end_point, 2.0f / 3.0f);
-            xy right_1 = lerp(split, begin_point, 2.0f / 3.0f);
-            xy right_2 = lerp(point_2, begin_point, 2.0f / 3.0f);
-            add_bezier(point_1, left_1, left_2, split, angular);
-            add_bezier(split, right_1, right_2, point_2, angular);
+            xy point_2 = outline[first];
+            outline.push_back(lerp(point_1, end_point, 2.0f / 3.0f));
+            outline.push_back(lerp(split, end_point, 2.0f / 3.0f));
+            outline.push_back(split);
+            outline.push_back(lerp(split, begin_point, 2.0f / 3.0f));
+            outline.push_back(lerp(point_2, begin_point, 2.0f / 3.0f));
+            outline.push_back(point_2);
+            into.straight.push_back(false);
+            into.straight.push_back(false);
         }
-        lines.points.push_back(lines.points[first]);
-        subpath_data entry = { lines.points.size() - first, true };
-        lines.subpaths.push_back(entry);
+        outline.insert(outline.end(), 3, outline[first]);
+        into.straight.push_back(true);
+        subpath_data entry = { outline.size() - first, true };
+        into.outline.subpaths.push_back(entry);
+    }
+}
+
+// Find a glyph's entry in the glyph cache, adding a blank one the first time
+// that the glyph is drawn.  Entries are only made for glyphs that are
+// actually drawn, so the cache costs nothing up front, no matter how many
+// glyphs the font has.  The entries are few enough for a linear search.
+//
+glyph_cache& canvas::cached_glyph(
+    int glyph)
+{
+    size_t index = 0;
+    while (index < glyphs.size() && glyphs[index].glyph != glyph)
+        ++index;
+    if (index == glyphs.size()) {
+        glyph_cache blank;
+        blank.glyph = glyph;
+        blank.bytes = sizeof(glyph_cache);
+        blank.loaded = false;
+        blank.flattened = false;
+        glyphs.push_back(blank);
+        glyph_bytes += blank.bytes;
+    }
+    glyphs[index].last_use = ++glyph_uses;
+    return glyphs[index];
+}
+
+// Keep the glyph cache within its memory limit.  The entry just drawn has its
+// size recounted, then the least recently drawn glyphs are dropped until the
+// cache fits again.  The entry just drawn is always kept, even by itself
+// over the limit, since it is likely to be drawn again soon.
+//
+void canvas::trim_glyphs(
+    glyph_cache& drawn)
+{
+    static size_t const limit = 64 * 1024;
+    size_t bytes = sizeof(glyph_cache) +
+        drawn.outline.points.capacity() * sizeof(xy) +
+        drawn.outline.subpaths.capacity() * sizeof(subpath_data) +
+        drawn.straight.capacity() / 8 +
+        drawn.lines.points.capacity() * sizeof(xy) +
+        drawn.lines.subpaths.capacity() * sizeof(subpath_data);
+    glyph_bytes += bytes - drawn.bytes;
+    drawn.bytes = bytes;
+    int keep = drawn.glyph;
+    while (glyph_bytes > limit && glyphs.size() > 1) {
+        size_t oldest = glyphs.size();
+        for (size_t index = 0; index < glyphs.size(); ++index)
+            if (glyphs[index].glyph != keep &&
+                (oldest == glyphs.size() ||
+                    glyphs[index].last_use < glyphs[oldest].last_use))
+                oldest = index;
+        glyph_bytes -= glyphs[oldest].bytes;
+        if (oldest != glyphs.size() - 1)
+            std::swap(glyphs[oldest], glyphs.back());
+        glyphs.pop_back();
     }
 }
 
+// Add a text glyph directly to the polylines.  The glyph's outline is loaded
+// into the glyph cache the first time that it is needed, so the TTF data is
+// only parsed once per glyph while it stays cached.  The cache also keeps the
+// outline tessellated to polylines for the last transform it was drawn with,
+// minus the translation.  Since text is usually drawn at the same size and
+// angle from frame to frame, and the tessellation does not depend on where
+// the glyph is placed, adding the glyph then usually only needs to offset
+// those.  Otherwise, it tessellates the outline anew using the current
+// transform matrix to map from font units to the proper size and position on
+// the canvas.  Whenever the entry grows, the cache is trimmed to its limit.
+//
+void canvas::add_glyph(
+    int glyph,
+    float angular)
+{
+    int glyph_count = unsigned_16(face.data, face.maxp + 4);
+    glyph_cache uncached;
+    glyph_cache* cached = &uncached;
+    if (0 <= glyph && glyph < glyph_count)
+        cached = &cached_glyph(glyph);
+    else
+        cached->loaded = cached->flattened = false;
+    affine_matrix scaling = { forward.a, forward.b, forward.c, forward.d,
+        0.0f, 0.0f };
+    bool changed = false;
+    if (!cached->loaded) {
+        affine_matrix identity = { 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f };
+        load_glyph(glyph, identity, *cached);
+        cached->loaded = true;
+        changed = true;
+    }
+    if (!cached->flattened || !(cached->scaling == scaling) || cached->angular != angular) {
+        changed = true;
+        bezier_path const& outline = cached->outline;
+        size_t beginning = lines.points.size();
+        size_t subpaths = lines.subpaths.size();
+        size_t index = 0;
+        size_t segment = 0;
+        size_t ending = 0;
+        for (size_t subpath = 0; subpath < outline.subpaths.size(); ++subpath) {
+            ending += outline.subpaths[subpath].count;
+            size_t first = lines.points.size();
+            xy point_1 = scaling * outline.points[index++];
+            lines.points.push_back(point_1);
+            for (; index < ending; index += 3) {
+                xy point_2 = scaling * outline.points[index + 2];
+                if (cached->straight[segment++])
+                    lines.points.push_back(point_2);
+                else
+                    add_bezier(point_1, scaling * outline.points[index + 0],
+                        scaling * outline.points[index + 1], point_2,
+                        angular);
+                point_1 = point_2;
+            }
+            subpath_data entry = { lines.points.size() - first, true };
+            lines.subpaths.push_back(entry);
+        }
+        cached->lines.points.assign(
+            lines.points.begin() + static_cast<ptrdiff_t>(beginning),
+            lines.points.end());
+        cached->lines.subpaths.assign(
+            lines.subpaths.begin() + static_cast<ptrdiff_t>(subpaths),
+            lines.subpaths.end());
+        lines.points.resize(beginning);
+        lines.subpaths.resize(subpaths);
+        cached->flattened = true;
+        cached->scaling = scaling;
+        cached->angular = angular;
+    }
+    xy offset = xy(forward.e, forward.f);
+    for (size_t index = 0; index < cached->lines.points.size(); ++index)
+        lines.points.push_back(cached->lines.points[index] + offset);
+    lines.subpaths.insert(lines.subpaths.end(),
+        cached->lines.subpaths.begin(), cached->lines.subpaths.end());
+    if (changed && cached != &uncached)
+        trim_glyphs(*cached);
+}
+
 // Decode the next codepoint from a null-terminated UTF-8 string to its glyph
 // index within the font.  The index to the next codepoint in the string
 // is advanced accordingly.  It checks for valid UTF-8 encoding, but not
@@ -2158,6 +3034,248 @@ void canvas::stroke_lines()
     }
 }
 
+#ifdef CANVAS_ITY_FIXED_POINT
+
+// Convert a coordinate to 24.8 fixed point, rounding to the nearest 1/256th
+// of a pixel.  Coordinates are clipped to the canvas first, so they are
+// never negative and truncation rounds down.
+//
+static int to_fixed(
+    float value)
+{
+    return static_cast<int>(value * 256.0f + 0.5f);
+}
+
+// Incrementally find where a segment crosses successive grid lines.  The
+// value starts at a + b * c / d, rounded to nearest, for some b of at most
+// 256, and each step adds 256 to b, so the quotient and remainder advance
+// with just integer adds.  The products fit in an int unless a segment
+// spans more than 16384 pixels.  Those fall back to a double, which holds
+// the product exactly, and any off-by-one in its rounded quotient is fixed
+// up from the exact remainder.  Either way, each crossing is correctly
+// rounded and comes out the same on every platform.  The divisor must be
+// positive.  Most segments are short and cross only a grid line or two, so
+// the size of the step is only divided out when more than one step will be
+// taken.  Nearly flat segments can have steps that do not fit in an int;
+// since they leave the segment after a step or two and the values past its
+// end are never used, those steps are just capped.
+//
+struct fixed_step {
+    int value;
+    int remainder;
+    int quotient;
+    int excess;
+    int divisor;
+};
+
+static void divide_exactly(
+    int b,
+    int c,
+    int d,
+    int bias,
+    int& quotient,
+    int& remainder)
+{
+    if (-4194304 < c && c < 4194304) {
+        quotient = (b * c + bias) / d;
+        remainder = (b * c + bias) % d;
+        if (remainder < 0) {
+            --quotient;
+            remainder += d;
+        }
+        return;
+    }
+    double numerator = static_cast<double>(b) * c + bias;
+    double whole = floor(numerator / d);
+    double rest = numerator - whole * d;
+    if (rest < 0.0) {
+        whole -= 1.0;
+        rest += d;
+    } else if (rest >= d) {
+        whole += 1.0;
+        rest -= d;
+    }
+    quotient = static_cast<int>(std::min(std::max(whole, -1073741824.0),
+        1073741824.0));
+    remainder = static_cast<int>(rest);
+}
+
+static fixed_step start_step(
+    int a,
+    int b,
+    int c,
+    int d,
+    bool stepping)
+{
+    fixed_step walk;
+    divide_exactly(b, c, d, d >> 1, walk.value, walk.remainder);
+    walk.value += a;
+    walk.quotient = 0;
+    walk.excess = 0;
+    if (stepping)
+        divide_exactly(256, c, d, 0, walk.quotient, walk.excess);
+    walk.divisor = d;
+    return walk;
+}
+
+static void advance(
+    fixed_step& walk)
+{
+    walk.remainder += walk.excess;
+    int over = walk.remainder >= walk.divisor ? 1 : 0;
+    walk.value += walk.quotient + over;
+    walk.remainder -= walk.divisor * over;
+}
+
+// Scan-convert a single polyline segment in 24.8 fixed point.  This gives
+// the same list of changes in signed coverage as the floating point version
+// below, but snaps the end points to 1/256th of a pixel and then walks the
+// segment row by row, top to bottom.  Within each row it walks the pixels
+// in the direction that the segment travels so that the grid crossings can
+// be stepped along the whole segment.  Going right to left, each change is
+// held back until the area carried into it from its left neighbor is known.
+// Heights and areas are integers in 1/65536ths and 1/131072ths of a pixel,
+// which convert to float without rounding, and the heights of the pieces
+// within each row always add up exactly.  Rows that stay within one pixel
+// column take a shortcut with a single piece, and vertical segments, as in
+// axis-aligned shapes, skip finding the crossings altogether.
+//
+void canvas::add_runs(
+    xy from,
+    xy to)
+{
+    int x_0 = to_fixed(from.x);
+    int y_0 = to_fixed(from.y);
+    int x_1 = to_fixed(to.x);
+    int y_1 = to_fixed(to.y);
+    if (y_0 == y_1)
+        return;
+    float sign = 1.0f / 131072.0f;
+    if (y_0 > y_1) {
+        std::swap(x_0, x_1);
+        std::swap(y_0, y_1);
+        sign = -sign;
+    }
+    int x_span = x_1 - x_0;
+    int y_span = y_1 - y_0;
+    int rows = ((y_1 - 1) >> 8) - (y_0 >> 8);
+    if (!x_span) {
+        size_t place = runs.size();
+        runs.resize(place + 2 * static_cast<size_t>(rows) + 2);
+        pixel_run* piece = &runs[place];
+        unsigned short x = static_cast<unsigned short>(x_0 >> 8);
+        int middle = (x_0 & 255) << 1;
+        for (int row = y_0 >> 8; row <= (y_1 - 1) >> 8; ++row) {
+            int height = std::min(y_1, (row + 1) << 8) - std::max(y_0, row << 8);
+            int area = height * middle;
+            piece[0].x = x;
+            piece[0].y = static_cast<unsigned short>(row);
+            piece[0].delta = static_cast<float>((height << 9) - area) * sign;
+            piece[1].x = static_cast<unsigned short>(x + 1);
+            piece[1].y = static_cast<unsigned short>(row);
+            piece[1].delta = static_cast<float>(area) * sign;
+            piece += 2;
+        }
+        return;
+    }
+    fixed_step row_x = { x_1, 0, 0, 0, 1 };
+    if (rows)
+        row_x = start_step(x_0, (((y_0 >> 8) + 1) << 8) - y_0, x_span,
+            y_span, rows > 1);
+    int column_x = x_span < 0 ? ((x_0 - 1) >> 8) << 8 : ((x_0 >> 8) + 1) << 8;
+    int columns = ((std::max(x_0, x_1) - 1) >> 8) - (std::min(x_0, x_1) >> 8);
+    fixed_step column_y = { 0, 0, 0, 0, 0 };
+    int top_x = x_0;
+    for (int row = y_0 >> 8; row <= (y_1 - 1) >> 8; ++row) {
+        int top = std::max(y_0, row << 8);
+        int bottom = std::min(y_1, (row + 1) << 8);
+        int bottom_x = bottom == y_1 ? x_1 : row_x.value;
+        advance(row_x);
+        int left = std::min(top_x, bottom_x);
+        int right = std::max(top_x, bottom_x);
+        top_x = bottom_x;
+        int first = left >> 8;
+        int last = right > left ? (right - 1) >> 8 : first;
+        unsigned short y = static_cast<unsigned short>(row);
+        if (first == last) {
+            int height = bottom - top;
+            int area = height * (left + right - (first << 9));
+            pixel_run piece_1 = { static_cast<unsigned short>(first), y,
+                static_cast<float>((height << 9) - area) * sign };
+            pixel_run piece_2 = { static_cast<unsigned short>(first + 1), y,
+                static_cast<float>(area) * sign };
+            runs.push_back(piece_1);
+            runs.push_back(piece_2);
+            continue;
+        }
+        size_t place = runs.size();
+        runs.resize(place + static_cast<size_t>(last - first) + 2);
+        pixel_run* piece = &runs[place];
+        if (!column_y.divisor)
+            column_y = start_step(y_0,
+                x_span < 0 ? x_0 - column_x : column_x - x_0, y_span,
+                std::abs(x_span), columns > 1);
+        int from_y = top;
+        if (x_span > 0) {
+            for (; column_x <= left; column_x += 256)
+                advance(column_y);
+            int carry = 0;
+            int from_x = left;
+            for (int column = first; column <= last; ++column) {
+                int to_x = right;
+                int to_y = bottom;
+                if (column < last) {
+                    to_x = column_x;
+                    to_y = column_y.value;
+                    column_x += 256;
+                    advance(column_y);
+                }
+                int height = to_y - from_y;
+                int area = height * (from_x + to_x - (column << 9));
+                piece->x = static_cast<unsigned short>(column);
+                piece->y = y;
+                piece->delta = static_cast<float>(carry + (height << 9) - area) * sign;
+                ++piece;
+                carry = area;
+                from_x = to_x;
+                from_y = to_y;
+            }
+            piece->x = static_cast<unsigned short>(last + 1);
+            piece->y = y;
+            piece->delta = static_cast<float>(carry) * sign;
+        } else {
+            for (; column_x >= right; column_x -= 256)
+                advance(column_y);
+            int held = 0;
+            int from_x = right;
+            for (int column = last; column >= first; --column) {
+                int to_x = left;
+                int to_y = bottom;
+                if (column > first) {
+                    to_x = column_x;
+                    to_y = column_y.value;
+                    column_x -= 256;
+                    advance(column_y);
+                }
+                int height = to_y - from_y;
+                int area = height * (from_x + to_x - (column << 9));
+                piece->x = static_cast<unsigned short>(column + 1);
+                piece->y = y;
+                piece->delta = static_cast<float>(held + area) * sign;
+                ++piece;
+                held = (height << 9) - area;
+                from_x = to_x;
+                from_y = to_y;
+            }
+            piece->x = static_cast<unsigned short>(first);
+            piece->y = y;
+            piece->delta = static_cast<float>(held) * sign;
+        }
+    }
+}
+
+#else
+
 // Scan-convert a single polyline segment.  This walks along the pixels that
 // the segment touches in left-to-right order, using signed trapezoidal area
 // to accumulate a list of changes in signed coverage at each visible pixel
@@ -2225,6 +3343,8 @@ void canvas::add_runs(
     } while (now.y != to.y);
 }
 
+#endif
+
 static bool operator<(
     pixel_run left,
     pixel_run right)
@@ -2235,6 +3355,55 @@ static bool operator<(
                                                        : fabsf(left.delta) < fabsf(right.delta));
 }
 
+// Order runs by row alone, for finding where a row starts in a sorted list.
+//
+static bool above(
+    pixel_run run,
+    int y)
+{
+    return run.y < y;
+}
+
+// Sort the runs into top-to-bottom, left-to-right order.  Since the run
+// coordinates are small integers bounded by the canvas size and padding,
+// this uses a two-pass least-significant-digit radix sort, first on x and
+// then on y.  Each pass is a stable counting sort with a histogram the size
+// of that dimension, so the whole sort is linear in the number of runs and
+// reuses its buffers from one draw to the next.  Short lists are insertion
+// sorted instead, which is also stable.  Being stable, runs that land on the
+// same pixel keep the order that they were generated in.
+//
+void canvas::sort_runs(
+    size_t columns,
+    size_t rows)
+{
+    if (runs.size() < 64) {
+        for (size_t index = 1; index < runs.size(); ++index) {
+            pixel_run run = runs[index];
+            size_t place = index;
+            for (; place > 0 && (runs[place - 1].y > run.y || (runs[place - 1].y == run.y && runs[place - 1].x > run.x)); --place)
+                runs[place] = runs[place - 1];
+            runs[place] = run;
+        }
+        return;
+    }
+    run_buffer.resize(runs.size());
+    run_counts.assign(columns + 1, 0);
+    for (size_t index = 0; index < runs.size(); ++index)
+        ++run_counts[runs[index].x + 1u];
+    for (size_t column = 1; column < columns; ++column)
+        run_counts[column] += run_counts[column - 1];
+    for (size_t index = 0; index < runs.size(); ++index)
+        run_buffer[run_counts[runs[index].x]++] = runs[index];
+    run_counts.assign(rows + 1, 0);
+    for (size_t index = 0; index < run_buffer.size(); ++index)
+        ++run_counts[run_buffer[index].y + 1u];
+    for (size_t row = 1; row < rows; ++row)
+        run_counts[row] += run_counts[row - 1];
+    for (size_t index = 0; index < run_buffer.size(); ++index)
+        runs[run_counts[run_buffer[index].y]++] = run_buffer[index];
+}
+
 // Scan-convert the polylines to prepare them for antialiased rendering.
 // For each of the polyline loops, it first clips them to the screen.
 // See "Reentrant Polygon Clipping" by Sutherland and Hodgman for details.
@@ -2294,7 +3463,8 @@ void canvas::lines_to_runs(
     }
     if (runs.empty())
         return;
-    std::sort(runs.begin(), runs.end());
+    sort_runs(static_cast<size_t>(size_x + padding) + 2,
+        static_cast<size_t>(size_y + padding) + 2);
     size_t to = 0;
     for (size_t from = 1; from < runs.size(); ++from)
         if (runs[from].x == runs[to].x && runs[from].y == runs[to].y)
@@ -2305,16 +3475,117 @@ void canvas::lines_to_runs(
         runs.end());
 }
 
-// Paint a pixel according to its point location and a paint style to produce
-// a premultiplied, linearized RGBA color.  This handles all supported paint
-// styles: solid colors, linear gradients, radial gradients, and patterns.
-// For gradients and patterns, it takes into account the current transform.
-// Patterns are resampled using a separable bicubic convolution filter,
-// with edges handled according to the wrap mode.  See "Cubic Convolution
-// Interpolation for Digital Image Processing" by Keys.  This filter is best
-// known for magnification, but also works well for antialiased minification,
-// since it's actually a Catmull-Rom spline approximation of Lanczos-2.
+// Compute the color of a gradient brush at an offset along the gradient.
+// This finds the stops on either side of the offset and interpolates between
+// their colors.  Offsets before the first stop or after the last one take
+// the color of that stop.
 //
+static rgba const gradient_color(
+    paint_brush const& brush,
+    float offset)
+{
+    size_t index = static_cast<size_t>(
+        std::upper_bound(brush.stops.begin(), brush.stops.end(), offset) - brush.stops.begin());
+    if (index == 0)
+        return premultiplied(brush.colors.front());
+    if (index == brush.stops.size())
+        return premultiplied(brush.colors.back());
+    float mix = ((offset - brush.stops[index - 1]) / (brush.stops[index] - brush.stops[index - 1]));
+    rgba delta = brush.colors[index] - brush.colors[index - 1];
+    return premultiplied(brush.colors[index - 1] + mix * delta);
+}
+
+// Tabulate the colors of a gradient brush.  Rather than searching for the
+// stops around each pixel's offset along the gradient, paint_pixel() looks
+// up the two nearest of 256 colors sampled evenly across the offsets from
+// zero to one and interpolates between them.  Between stops the colors
+// change linearly with the offset, or nearly so once premultiplied, so this
+// is practically exact.  Interpolating across a stop would blur the corner
+// or the sharp transition there, though, which shows as smudges near black
+// once converted to sRGB.  So the few intervals holding a stop are marked as
+// kinks, and pixels that fall in those are computed directly instead.
+//
+static void tabulate(
+    paint_brush& brush)
+{
+    brush.table.resize(256);
+    brush.kinks.assign(255, false);
+    for (size_t entry = 0; entry < brush.table.size(); ++entry)
+        brush.table[entry] = gradient_color(brush, static_cast<float>(entry) / 255.0f);
+    for (size_t stop = 0; stop < brush.stops.size(); ++stop) {
+        float place = brush.stops[stop] * 255.0f;
+        int index = static_cast<int>(ceilf(place)) - 1;
+        if (0 <= index && index < 255)
+            brush.kinks[static_cast<size_t>(index)] = true;
+        if (place == ceilf(place) && index + 1 < 255)
+            brush.kinks[static_cast<size_t>(index + 1)] = true;
+    }
+}
+
+// Find the pixel of a pattern that a pixel coordinate, possibly outside of
+// it, samples.  Patterns wrap around, while images clamp to the nearest edge
+// so that their borders do not bleed into each other.
+//
+static int wrapped_index(
+    int index,
+    int size,
+    bool clamp)
+{
+    if (clamp)
+        return std::min(std::max(index, 0), size - 1);
+    index %= size;
+    return index < 0 ? index + size : index;
+}
+
+// Weight of a source pixel for resampling, given its distance from the
+// sample point in units of the filter's scale.  Bicubic convolution spans two
+// units to either side, while the tent used for bilinear filtering spans one.
+//
+static float filter_weight(
+    float distance,
+    filter_style filter)
+{
+    if (filter != bicubic)
+        return std::max(1.0f - distance, 0.0f);
+    return (distance < 1.0f ? (1.5f * distance - 2.5f) * distance * distance + 1.0f : ((-0.5f * distance + 2.5f) * distance - 4.0f) * distance + 2.0f);
+}
+
+// Bicubic convolution weights for the four source pixels around a sample
+// point, tabulated for 1024 evenly spaced subpixel phases plus the end.  When
+// not minifying, the filter footprint is always these four pixels, so this
+// saves paint_pixel() from evaluating the polynomial for each of the sixteen
+// taps.  Each set is normalized to sum to one so that no division is needed
+// afterwards.  Rounding the phase shifts a sample by at most 1/2048 of a
+// pixel, which changes colors by at most one step in eight bits.
+//
+struct bicubic_table {
+    float weights[1025][4];
+};
+
+static bicubic_table const tabulate_bicubic()
+{
+    bicubic_table table;
+    for (int phase = 0; phase <= 1024; ++phase) {
+        float offset = static_cast<float>(phase) / 1024.0f;
+        float* weights = table.weights[phase];
+        weights[0] = filter_weight(1.0f + offset, bicubic);
+        weights[1] = filter_weight(offset, bicubic);
+        weights[2] = filter_weight(1.0f - offset, bicubic);
+        weights[3] = filter_weight(2.0f - offset, bicubic);
+        float reciprocal = 1.0f / (weights[0] + weights[1] + weights[2] + weights[3]);
+        for (int tap = 0; tap < 4; ++tap)
+            weights[tap] *= reciprocal;
+    }
+    return table;
+}
+
+static float const* bicubic_weights(
+    float phase)
+{
+    static bicubic_table const table = tabulate_bicubic();
+    return table.weights[static_cast<int>(phase * 1024.0f + 0.5f)];
+}
+
 rgba canvas::paint_pixel(
     xy point,
     paint_brush const& brush)
@@ -2329,37 +3600,63 @@ rgba canvas::paint_pixel(
         float height = static_cast<float>(brush.height);
         if (((brush.repetition & 2) && (point.x < 0.0f || width <= point.x)) || ((brush.repetition & 1) && (point.y < 0.0f || height <= point.y)))
             return rgba(0.0f, 0.0f, 0.0f, 0.0f);
+        bool clamp = &brush == &image_brush;
+        if (image_filter == nearest) {
+            int column = wrapped_index(static_cast<int>(floorf(point.x)), brush.width, clamp);
+            int row = wrapped_index(static_cast<int>(floorf(point.y)), brush.height, clamp);
+            return brush.colors[static_cast<size_t>(row * brush.width + column)];
+        }
         float scale_x = fabsf(inverse.a) + fabsf(inverse.c);
         float scale_y = fabsf(inverse.b) + fabsf(inverse.d);
         scale_x = std::max(1.0f, std::min(scale_x, width * 0.25f));
         scale_y = std::max(1.0f, std::min(scale_y, height * 0.25f));
+        point -= xy(0.5f, 0.5f);
+        if (scale_x == 1.0f && scale_y == 1.0f) {
+            float base_x = floorf(point.x);
+            float base_y = floorf(point.y);
+            int column = static_cast<int>(base_x);
+            int row = static_cast<int>(base_y);
+            if (image_filter == bilinear) {
+                float across = point.x - base_x;
+                float down = point.y - base_y;
+                int left = wrapped_index(column, brush.width, clamp);
+                int right = wrapped_index(column + 1, brush.width, clamp);
+                int top = wrapped_index(row, brush.height, clamp) * brush.width;
+                int bottom = wrapped_index(row + 1, brush.height, clamp) * brush.width;
+                rgba upper = ((1.0f - across) * brush.colors[static_cast<size_t>(top + left)] + across * brush.colors[static_cast<size_t>(top + right)]);
+                rgba lower = ((1.0f - across) * brush.colors[static_cast<size_t>(bottom + left)] + across * brush.colors[static_cast<size_t>(bottom + right)]);
+                return (1.0f - down) * upper + down * lower;
+            }
+            float const* weights_x = bicubic_weights(point.x - base_x);
+            float const* weights_y = bicubic_weights(point.y - base_y);
+            int columns[4];
+            for (int tap = 0; tap < 4; ++tap)
+                columns[tap] = wrapped_index(column + tap - 1, brush.width, clamp);
+            rgba total_color = rgba(0.0f, 0.0f, 0.0f, 0.0f);
+            for (int tap = 0; tap < 4; ++tap) {
+                rgba const* source = &brush.colors[static_cast<size_t>(
+                    wrapped_index(row + tap - 1, brush.height, clamp) * brush.width)];
+                rgba row_color = (weights_x[0] * source[columns[0]] + weights_x[1] * source[columns[1]] +
+                    weights_x[2] * source[columns[2]] + weights_x[3] * source[columns[3]]);
+                total_color += weights_y[tap] * row_color;
+            }
+            return total_color;
+        }
+        float radius = image_filter == bicubic ? 2.0f : 1.0f;
         float reciprocal_x = 1.0f / scale_x;
         float reciprocal_y = 1.0f / scale_y;
-        point -= xy(0.5f, 0.5f);
-        int left = static_cast<int>(ceilf(point.x - scale_x * 2.0f));
-        int top = static_cast<int>(ceilf(point.y - scale_y * 2.0f));
-        int right = static_cast<int>(ceilf(point.x + scale_x * 2.0f));
-        int bottom = static_cast<int>(ceilf(point.y + scale_y * 2.0f));
+        int left = static_cast<int>(ceilf(point.x - scale_x * radius));
+        int top = static_cast<int>(ceilf(point.y - scale_y * radius));
+        int right = static_cast<int>(ceilf(point.x + scale_x * radius));
+        int bottom = static_cast<int>(ceilf(point.y + scale_y * radius));
         rgba total_color = rgba(0.0f, 0.0f, 0.0f, 0.0f);
         float total_weight = 0.0f;
         for (int pattern_y = top; pattern_y < bottom; ++pattern_y) {
-            float y = fabsf(reciprocal_y * (static_cast<float>(pattern_y) - point.y));
-            float weight_y = (y < 1.0f ? (1.5f * y - 2.5f) * y * y + 1.0f : ((-0.5f * y + 2.5f) * y - 4.0f) * y + 2.0f);
-            int wrapped_y = pattern_y % brush.height;
-            if (wrapped_y < 0)
-                wrapped_y += brush.height;
-            if (&brush == &image_brush)
-                wrapped_y = std::min(std::max(pattern_y, 0),
-                    brush.height - 1);
+            float weight_y = filter_weight(fabsf(reciprocal_y * (static_cast<float>(pattern_y) - point.y)), image_filter);
+            int wrapped_y = wrapped_index(pattern_y, brush.height, clamp);
             for (int pattern_x = left; pattern_x < right; ++pattern_x) {
-                float x = fabsf(reciprocal_x * (static_cast<float>(pattern_x) - point.x));
-                float weight_x = (x < 1.0f ? (1.5f * x - 2.5f) * x * x + 1.0f : ((-0.5f * x + 2.5f) * x - 4.0f) * x + 2.0f);
-                int wrapped_x = pattern_x % brush.width;
-                if (wrapped_x < 0)
-                    wrapped_x += brush.width;
-                if (&brush == &image_brush)
-                    wrapped_x = std::min(std::max(pattern_x, 0),
-                        brush.width - 1);
+                float weight_x = filter_weight(fabsf(reciprocal_x * (static_cast<float>(pattern_x) - point.x)), image_filter);
+                int wrapped_x = wrapped_index(pattern_x, brush.width, clamp);
                 float weight = weight_x * weight_y;
                 size_t index = static_cast<size_t>(
                     wrapped_y * brush.width + wrapped_x);
@@ -2400,15 +3697,210 @@ rgba canvas::paint_pixel(
         else
             return rgba(0.0f, 0.0f, 0.0f, 0.0f);
     }
-    size_t index = static_cast<size_t>(
-        std::upper_bound(brush.stops.begin(), brush.stops.end(), offset) - brush.stops.begin());
-    if (index == 0)
-        return premultiplied(brush.colors.front());
-    if (index == brush.stops.size())
-        return premultiplied(brush.colors.back());
-    float mix = ((offset - brush.stops[index - 1]) / (brush.stops[index] - brush.stops[index - 1]));
-    rgba delta = brush.colors[index] - brush.colors[index - 1];
-    return premultiplied(brush.colors[index - 1] + mix * delta);
+    if (!(offset > 0.0f))
+        return brush.table.front();
+    if (offset >= 1.0f)
+        return brush.table.back();
+    float place = offset * 255.0f;
+    int index = std::min(static_cast<int>(place), 254);
+    if (brush.kinks[static_cast<size_t>(index)])
+        return gradient_color(brush, offset);
+    rgba left = brush.table[static_cast<size_t>(index)];
+    rgba right = brush.table[static_cast<size_t>(index) + 1];
+    return left + (place - static_cast<float>(index)) * (right - left);
+}
+
+// Fetch a pixel from the canvas as a premultiplied, linearized color.  When
+// the pixels are 8-bit, either in an external image or in compact storage,
+// this converts from their premultiplied sRGB form, and write_pixel() does
+// the reverse with rounding.  Routing every access to the pixels through
+// these, and blend_span() below, keeps the rest of the rendering independent
+// of where and how the pixels are actually stored.
+//
+rgba canvas::read_pixel(
+    int x,
+    int y) const
+{
+    if (!target)
+        return bitmap[y * size_x + x];
+    unsigned int channels[4];
+    unpack_pixel(target + y * target_stride + x * 4, channels);
+    return (1.0f / 65535.0f) * rgba(
+               static_cast<float>(channels[0]), static_cast<float>(channels[1]),
+               static_cast<float>(channels[2]), static_cast<float>(channels[3]));
+}
+
+void canvas::write_pixel(
+    int x,
+    int y,
+    rgba color)
+{
+    if (!target) {
+        bitmap[y * size_x + x] = color;
+        return;
+    }
+    unsigned int channels[4];
+    quantized(color, channels);
+    pack_pixel(channels, target + y * target_stride + x * 4);
+}
+
+// Composite a premultiplied, linearized color onto a horizontal span of
+// pixels according to the current compositing operation, then mix the result
+// with the original pixels by the clip mask visibility.  Each operation is
+// expressed as a weight on the incoming color plus a weight on the existing
+// one, where each weight is zero, one, or the other color's alpha, or one
+// minus that.  Everything but the weight taken from the existing alpha is the
+// same across the span, so it is set up once and then the float pixels are
+// blended with one pixel per vector where SIMD is available.  For 8-bit
+// pixels, the same is done in 16-bit fixed point on the unpacked channels,
+// and spans that are simply overwritten with an opaque color are packed once
+// and filled four pixels at a time.
+//
+void canvas::blend_span(
+    int x,
+    int y,
+    int width,
+    rgba fore,
+    float visibility)
+{
+    int operation = global_composite_operation;
+    if (!target) {
+        rgba* back = &bitmap[y * size_x + x];
+        float mix_back = operation & 4 ? fore.a : 0.0f;
+        if (operation & 8)
+            mix_back = 1.0f - mix_back;
+#if defined(CANVAS_ITY_SSE2) || defined(CANVAS_ITY_SIMD128)
+        // Same as below, with the visibility folded into the weights
+        float fore_base = operation & 2 ? 1.0f : 0.0f;
+        float fore_slope = operation & 1 ? 1.0f - 2.0f * fore_base : 0.0f;
+        lanes fore_lanes = lanes_load(&fore.r);
+        lanes base_lanes = lanes_splat(visibility * fore_base);
+        lanes slope_lanes = lanes_splat(visibility * fore_slope);
+        lanes back_lanes = lanes_splat(visibility * mix_back);
+        lanes keep_lanes = lanes_splat(1.0f - visibility);
+        lanes limit_lanes = lanes_set(FLT_MAX, FLT_MAX, FLT_MAX, visibility);
+        for (; width > 0; --width, ++back) {
+            lanes pixel = lanes_load(&back->r);
+            lanes mix_fore = lanes_add(base_lanes,
+                lanes_mul(slope_lanes, lanes_alpha(pixel)));
+            lanes blend = lanes_min(lanes_add(lanes_mul(mix_fore, fore_lanes),
+                                        lanes_mul(back_lanes, pixel)),
+                limit_lanes);
+            lanes_store(&back->r, lanes_add(blend, lanes_mul(keep_lanes, pixel)));
+        }
+#else
+        for (; width > 0; --width, ++back) {
+            float mix_fore = operation & 1 ? back->a : 0.0f;
+            if (operation & 2)
+                mix_fore = 1.0f - mix_fore;
+            rgba blend = mix_fore * fore + mix_back * *back;
+            blend.a = std::min(blend.a, 1.0f);
+            *back = visibility * blend + (1.0f - visibility) * *back;
+        }
+#endif
+        return;
+    }
+    unsigned char* pixel = target + y * target_stride + x * 4;
+    unsigned int back[4];
+    int front[4] = { signed_quantized(fore.r), signed_quantized(fore.g),
+                     signed_quantized(fore.b), signed_quantized(fore.a) };
+    unsigned int mix_back = operation & 4 ? quantized(fore.a) : 0;
+    if (operation & 8)
+        mix_back = 65535 - mix_back;
+    unsigned int cover = static_cast<unsigned int>(static_cast<int>(
+        std::min(std::max(visibility, 0.0f), 1.0f) * 65535.0f + 0.5f));
+    if (cover == 65535 && mix_back == 0 && operation == source_over) {
+        unsigned int channels[4];
+        quantized(fore, channels);
+        unsigned char packed[4];
+        pack_pixel(channels, packed);
+        fill_pixels(pixel, packed, width);
+        return;
+    }
+    for (; width > 0; --width, pixel += 4) {
+        unpack_pixel(pixel, back);
+        unsigned int mix_fore = operation & 1 ? back[3] : 0;
+        if (operation & 2)
+            mix_fore = 65535 - mix_fore;
+        unsigned int result[4];
+        for (int index = 0; index < 4; ++index) {
+            int blend = std::min(signed_multiplied(mix_fore, front[index]) +
+                    static_cast<int>(multiplied(mix_back, back[index])),
+                65535);
+            if (cover != 65535)
+                blend = signed_multiplied(cover, blend) +
+                    static_cast<int>(multiplied(65535 - cover, back[index]));
+            result[index] = static_cast<unsigned int>(
+                std::min(std::max(blend, 0), 65535));
+        }
+        pack_pixel(result, pixel);
+    }
+}
+
+// Helpers for blurring shadows.  The first does one pass of the box blur
+// described below down all the columns of a row-major image at once, reading
+// from one buffer and writing to another.  Keeping a running sum for each
+// column and stepping through the rows makes each step a multiply and add of
+// whole rows, which vectorizes and walks memory in order.  Blurring along the
+// rows is done the same way on the transposed image, which the second helper
+// produces.  The sums are updated in the same order as blurring each line
+// separately would, so the results do not depend on the vectorization.
+//
+static void accumulate(
+    float* running,
+    float const* row,
+    float weight,
+    size_t count)
+{
+    size_t index = 0;
+#if defined(CANVAS_ITY_SSE2) || defined(CANVAS_ITY_SIMD128)
+    lanes weights = lanes_splat(weight);
+    for (; index + 4 <= count; index += 4)
+        lanes_store(running + index, lanes_add(lanes_load(running + index),
+                                         lanes_mul(weights, lanes_load(row + index))));
+#endif
+    for (; index < count; ++index)
+        running[index] += weight * row[index];
+}
+static void blur_columns(
+    float const* from,
+    float* to,
+    float* running,
+    size_t columns,
+    size_t rows,
+    size_t radius,
+    float weight_1,
+    float weight_2)
+{
+    for (size_t column = 0; column < columns; ++column)
+        running[column] = weight_1 * from[(radius + 1) * columns + column];
+    for (size_t row = 0; row <= radius; ++row)
+        accumulate(running, from + row * columns, weight_1 + weight_2, columns);
+    std::copy(running, running + columns, to);
+    for (size_t row = 1; row < rows; ++row) {
+        if (row >= radius + 1)
+            accumulate(running, from + (row - radius - 1) * columns, -weight_2, columns);
+        if (row >= radius + 2)
+            accumulate(running, from + (row - radius - 2) * columns, -weight_1, columns);
+        if (row + radius < rows)
+            accumulate(running, from + (row + radius) * columns, weight_2, columns);
+        if (row + radius + 1 < rows)
+            accumulate(running, from + (row + radius + 1) * columns, weight_1, columns);
+        std::copy(running, running + columns, to + row * columns);
+    }
+}
+static void transpose(
+    float const* from,
+    float* to,
+    size_t columns,
+    size_t rows)
+{
+    static size_t const block = 16;
+    for (size_t top = 0; top < rows; top += block)
+        for (size_t left = 0; left < columns; left += block)
+            for (size_t row = top; row < std::min(top + block, rows); ++row)
+                for (size_t column = left; column < std::min(left + block, columns); ++column)
+                    to[column * rows + row] = from[row * columns + column];
 }
 
 // Render the shadow of the polylines into the pixel buffer if needed.  After
@@ -2421,9 +3913,12 @@ rgba canvas::paint_pixel(
 // each in the rows and columns.  Note that these box blurs have a small extra
 // weight on the tails to allow for fractional widths.  See "Theoretical
 // Foundations of Gaussian Convolution by Extended Box Filtering" by Gwosdek
-// et al. for details.  Finally, it colors the blurred alpha image with
+// et al. for details.  The working area and the space for blurring it are
+// kept between calls, so only the working area needs to be cleared each
+// time.  Finally, it colors the blurred alpha image with
 // the shadow color and blends this into the pixel buffer according to the
-// compositing settings and clip mask.  Note that it does not bother clearing
+// compositing settings and clip mask, scanning only the rows of the mask
+// that the alpha image covers.  Note that it does not bother clearing
 // outside the area of the alpha image when the compositing settings require
 // clearing; that will be done on the subsequent main rendering pass.
 //
@@ -2456,8 +3951,10 @@ void canvas::render_shadow(
     size_t width = static_cast<size_t>(std::max(right - left, 0));
     size_t height = static_cast<size_t>(std::max(bottom - top, 0));
     size_t working = width * height;
-    shadow.clear();
-    shadow.resize(working + std::max(width, height));
+    if (!working)
+        return;
+    shadow.resize(2 * working + std::max(width, height));
+    std::fill(shadow.begin(), shadow.begin() + static_cast<ptrdiff_t>(working), 0.0f);
     static float const threshold = 1.0f / 8160.0f;
     {
         int x = -1;
@@ -2481,68 +3978,36 @@ void canvas::render_shadow(
     float divisor = 2.0f * (alpha + static_cast<float>(radius)) + 1.0f;
     float weight_1 = alpha / divisor;
     float weight_2 = (1.0f - alpha) / divisor;
-    for (size_t y = 0; y < height; ++y)
-        for (int pass = 0; pass < 3; ++pass) {
-            for (size_t x = 0; x < width; ++x)
-                shadow[working + x] = shadow[y * width + x];
-            float running = weight_1 * shadow[working + radius + 1];
-            for (size_t x = 0; x <= radius; ++x)
-                running += (weight_1 + weight_2) * shadow[working + x];
-            shadow[y * width] = running;
-            for (size_t x = 1; x < width; ++x) {
-                if (x >= radius + 1)
-                    running -= weight_2 * shadow[working + x - radius - 1];
-                if (x >= radius + 2)
-                    running -= weight_1 * shadow[working + x - radius - 2];
-                if (x + radius < width)
-                    running += weight_2 * shadow[working + x + radius];
-                if (x + radius + 1 < width)
-                    running += weight_1 * shadow[working + x + radius + 1];
-                shadow[y * width + x] = running;
-            }
-        }
-    for (size_t x = 0; x < width; ++x)
-        for (int pass = 0; pass < 3; ++pass) {
-            for (size_t y = 0; y < height; ++y)
-                shadow[working + y] = shadow[y * width + x];
-            float running = weight_1 * shadow[working + radius + 1];
-            for (size_t y = 0; y <= radius; ++y)
-                running += (weight_1 + weight_2) * shadow[working + y];
-            shadow[x] = running;
-            for (size_t y = 1; y < height; ++y) {
-                if (y >= radius + 1)
-                    running -= weight_2 * shadow[working + y - radius - 1];
-                if (y >= radius + 2)
-                    running -= weight_1 * shadow[working + y - radius - 2];
-                if (y + radius < height)
-                    running += weight_2 * shadow[working + y + radius];
-                if (y + radius + 1 < height)
-                    running += weight_1 * shadow[working + y + radius + 1];
-                shadow[y * width + x] = running;
-            }
-        }
-    int operation = global_composite_operation;
+    float* image = &shadow[0];
+    float* other = image + working;
+    float* running = other + working;
+    transpose(image, other, width, height);
+    for (int pass = 0; pass < 3; ++pass) {
+        blur_columns(other, image, running, height, width, radius, weight_1, weight_2);
+        std::swap(image, other);
+    }
+    transpose(other, image, height, width);
+    std::swap(image, other);
+    for (int pass = 0; pass < 3; ++pass) {
+        blur_columns(other, image, running, width, height, radius, weight_1, weight_2);
+        std::swap(image, other);
+    }
+    if (other != &shadow[0])
+        std::copy(other, other + working, shadow.begin());
     int x = -1;
     int y = -1;
     float sum = 0.0f;
-    for (size_t index = 0; index < mask.size(); ++index) {
+    size_t index = static_cast<size_t>(
+        std::lower_bound(mask.begin(), mask.end(), top - border, above) - mask.begin());
+    for (; index < mask.size(); ++index) {
         pixel_run next = mask[index];
         float visibility = std::min(fabsf(sum), 1.0f);
         int to = std::min(next.y == y ? next.x : x + 1, right - border);
         if (visibility >= threshold && top <= y + border && y + border < bottom)
-            for (; x < to; ++x) {
-                rgba& back = bitmap[y * size_x + x];
-                rgba fore = global_alpha * shadow[static_cast<size_t>(y + border - top) * width + static_cast<size_t>(x + border - left)] * shadow_color;
-                float mix_fore = operation & 1 ? back.a : 0.0f;
-                if (operation & 2)
-                    mix_fore = 1.0f - mix_fore;
-                float mix_back = operation & 4 ? fore.a : 0.0f;
-                if (operation & 8)
-                    mix_back = 1.0f - mix_back;
-                rgba blend = mix_fore * fore + mix_back * back;
-                blend.a = std::min(blend.a, 1.0f);
-                back = visibility * blend + (1.0f - visibility) * back;
-            }
+            for (; x < to; ++x)
+                blend_span(x, y, 1, global_alpha * shadow[static_cast<size_t>(y + border - top) * width + static_cast<size_t>(x + border - left)] * shadow_color, visibility);
+        if (next.y + border >= bottom)
+            break;
         if (next.y != y)
             sum = 0.0f;
         x = std::max(static_cast<int>(next.x), left - border);
@@ -2551,51 +4016,51 @@ void canvas::render_shadow(
     }
 }
 
-// Render the polylines into the pixel buffer.  It scan-converts the lines
-// to runs which represent changes to the signed fractional coverage when
-// read from left-to-right, top-to-bottom.  It scans through these to
-// determine spans of pixels that need to be drawn, paints those pixels
-// according to the brush, and then blends them into the buffer according
-// to the current compositing settings.  This is slightly more complicated
-// because it interleaves this with a simultaneous scan through a similar
-// set of runs representing the current clip mask to determine which pixels
-// it can composite into.  Note that shadows are always drawn first.
+// Composite the runs from the given path and clip mask indices on into the
+// pixel buffer, stopping before the first row at or past the bottom.  It
+// scans through both sets of runs, which represent changes to the signed
+// fractional coverage when read from left-to-right, top-to-bottom, to
+// determine the spans of pixels that need to be drawn.  It then paints those
+// pixels according to the brush, and blends them into the buffer according
+// to the current compositing settings where the clip mask allows.  A solid
+// color brush paints the same color over a whole span, so such spans are
+// blended in one go rather than pixel by pixel.  The state of the scan
+// resets at the start of each row, so starting at the first runs of any row
+// gives the same result for that row as starting at the top.  When nothing
+// is clipped and the compositing operation leaves the pixels outside the
+// shape alone, the mask is just the canvas bounds, so it skips merging with
+// it and scans the path runs alone.
 //
-void canvas::render_main(
-    paint_brush const& brush)
+void canvas::render_rows(
+    paint_brush const& brush,
+    size_t path_index,
+    size_t clip_index,
+    int bottom)
 {
-    if (forward.a * forward.d - forward.b * forward.c == 0.0f)
-        return;
-    render_shadow(brush);
-    lines_to_runs(xy(0.0f, 0.0f), 0);
     int operation = global_composite_operation;
+    bool whole = !clipped && operation & 8;
     int x = -1;
     int y = -1;
     float path_sum = 0.0f;
     float clip_sum = 0.0f;
-    size_t path_index = 0;
-    size_t clip_index = 0;
-    while (clip_index < mask.size()) {
-        bool which = (path_index < runs.size() && runs[path_index] < mask[clip_index]);
+    while (whole ? path_index < runs.size() : clip_index < mask.size()) {
+        bool which = whole || (path_index < runs.size() && runs[path_index] < mask[clip_index]);
         pixel_run next = which ? runs[path_index] : mask[clip_index];
         float coverage = std::min(fabsf(path_sum), 1.0f);
-        float visibility = std::min(fabsf(clip_sum), 1.0f);
+        float visibility = whole ? 1.0f : std::min(fabsf(clip_sum), 1.0f);
         int to = next.y == y ? next.x : x + 1;
+        if (whole)
+            to = std::min(to, size_x);
         static float const threshold = 1.0f / 8160.0f;
-        if ((coverage >= threshold || ~operation & 8) && visibility >= threshold)
-            for (; x < to; ++x) {
-                rgba& back = bitmap[y * size_x + x];
-                rgba fore = coverage * global_alpha * paint_pixel(xy(static_cast<float>(x) + 0.5f, static_cast<float>(y) + 0.5f), brush);
-                float mix_fore = operation & 1 ? back.a : 0.0f;
-                if (operation & 2)
-                    mix_fore = 1.0f - mix_fore;
-                float mix_back = operation & 4 ? fore.a : 0.0f;
-                if (operation & 8)
-                    mix_back = 1.0f - mix_back;
-                rgba blend = mix_fore * fore + mix_back * back;
-                blend.a = std::min(blend.a, 1.0f);
-                back = visibility * blend + (1.0f - visibility) * back;
-            }
+        if ((coverage >= threshold || ~operation & 8) && visibility >= threshold) {
+            if (brush.type == paint_brush::color && x < to)
+                blend_span(x, y, to - x, coverage * global_alpha * paint_pixel(xy(0.0f, 0.0f), brush), visibility);
+            else
+                for (; x < to; ++x)
+                    blend_span(x, y, 1, coverage * global_alpha * paint_pixel(xy(static_cast<float>(x) + 0.5f, static_cast<float>(y) + 0.5f), brush), visibility);
+        }
+        if (next.y >= bottom)
+            break;
         x = next.x;
         if (next.y != y) {
             y = next.y;
@@ -2609,6 +4074,341 @@ void canvas::render_main(
     }
 }
 
+#ifdef CANVAS_ITY_THREADS
+
+// A minimal pool of worker threads for compositing bands in parallel.  The
+// run() call hands out the task indices through a shared counter to the
+// workers and the calling thread alike, and returns once they are all done.
+//
+struct worker_pool {
+    std::vector<std::thread> threads;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::function<void(int)> task;
+    std::atomic<int> next_task;
+    int task_count;
+    int busy;
+    unsigned int round;
+    bool stopping;
+
+    explicit worker_pool(int count)
+        : next_task(0)
+        , task_count(0)
+        , busy(0)
+        , round(0)
+        , stopping(false)
+    {
+        for (int index = 0; index < count; ++index)
+            threads.push_back(std::thread(&worker_pool::serve, this));
+    }
+    ~worker_pool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (size_t index = 0; index < threads.size(); ++index)
+            threads[index].join();
+    }
+    void work()
+    {
+        for (int index; (index = next_task++) < task_count;)
+            task(index);
+    }
+    void serve()
+    {
+        unsigned int seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                wake.wait(guard, [&] { return stopping || round != seen; });
+                if (stopping)
+                    return;
+                seen = round;
+            }
+            work();
+            std::lock_guard<std::mutex> guard(lock);
+            if (--busy == 0)
+                done.notify_one();
+        }
+    }
+    void run(int count, std::function<void(int)> const& function)
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            task = function;
+            task_count = count;
+            next_task = 0;
+            busy = static_cast<int>(threads.size());
+            ++round;
+        }
+        wake.notify_all();
+        work();
+        std::unique_lock<std::mutex> guard(lock);
+        done.wait(guard, [&] { return busy == 0; });
+    }
+};
+
+#endif
+
+// Composite the current runs into the pixel buffer with render_rows().  Unless
+// the compositing operation also affects pixels outside the shape, only the
+// rows between the first and last path runs can be affected, so it starts at
+// the first of those rows in the clip mask and stops after the last, rather
+// than scanning the mask for the whole canvas.  When there are worker
+// threads, it instead splits the rows that can be affected into horizontal
+// bands, finds where each band starts in the sorted path and clip mask runs,
+// and composites the bands in parallel.  Each band needs at least 32 rows to
+// be worth the synchronization.
+//
+void canvas::render_coverage(
+    paint_brush const& brush)
+{
+#ifdef CANVAS_ITY_THREADS
+    int operation = global_composite_operation;
+    int top = 0;
+    int bottom = size_y;
+    if (operation & 8) {
+        top = runs.empty() ? 0 : runs.front().y;
+        bottom = runs.empty() ? 0 : runs.back().y + 1;
+    }
+    int bands = std::min(4 * (workers ? static_cast<int>(workers->threads.size()) + 1 : 0),
+        (bottom - top) / 32);
+    if (bands >= 2) {
+        workers->run(bands, [&](int band) {
+            int from = top + (bottom - top) * band / bands;
+            int until = band + 1 == bands ? 65536 : top + (bottom - top) * (band + 1) / bands;
+            size_t path_index = static_cast<size_t>(
+                std::lower_bound(runs.begin(), runs.end(), from, above) - runs.begin());
+            size_t clip_index = static_cast<size_t>(
+                std::lower_bound(mask.begin(), mask.end(), from, above) - mask.begin());
+            render_rows(brush, path_index, clip_index, until);
+        });
+        return;
+    }
+#endif
+    size_t clip_index = 0;
+    int until = 65536;
+    if (global_composite_operation & 8) {
+        if (runs.empty())
+            return;
+        clip_index = static_cast<size_t>(
+            std::lower_bound(mask.begin(), mask.end(), runs.front().y, above) - mask.begin());
+        until = runs.back().y + 1;
+    }
+    render_rows(brush, 0, clip_index, until);
+}
+
+// Render the polylines into the pixel buffer.  It scan-converts the lines
+// to runs and then composites them.  Note that shadows are always drawn
+// first, serially.
+//
+void canvas::render_main(
+    paint_brush const& brush)
+{
+    if (forward.a * forward.d - forward.b * forward.c == 0.0f)
+        return;
+    render_shadow(brush);
+    lines_to_runs(xy(0.0f, 0.0f), 0);
+    render_coverage(brush);
+}
+
+retained_path::retained_path()
+{
+    affine_matrix identity = { 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f };
+    forward = identity;
+    inverse = identity;
+    filled.valid = false;
+    stroked.valid = false;
+}
+
+// Check whether the polylines and runs cached for a retained path are still
+// what converting it now would give.  That depends on the transform, the
+// canvas size that the runs are clipped to, and for strokes on the line
+// styles.  Everything after the runs, such as the brush, global alpha,
+// compositing operation, shadows, and clip mask, is applied afresh anyway.
+//
+bool canvas::is_current(
+    retained_path::coverage const& cached,
+    bool stroking) const
+{
+    if (!cached.valid || !(cached.transform == forward) ||
+        cached.size_x != size_x || cached.size_y != size_y)
+        return false;
+    return !stroking ||
+        (cached.line_width == line_width &&
+            cached.miter_limit == miter_limit &&
+            cached.line_dash_offset == line_dash_offset &&
+            cached.line_cap == line_cap &&
+            cached.line_join == line_join &&
+            cached.line_dash == line_dash);
+}
+
+// Bring the cached polylines and runs of a retained path up to date.  If
+// they are not current, it swaps the retained path in for the current one,
+// moves its points from the transform it was retained under to the current
+// one if they differ, and converts it the usual way before caching the
+// results.  Any stamps made from the old polylines are dropped.
+//
+void canvas::update_retained(
+    retained_path& retained,
+    retained_path::coverage& cached,
+    bool stroking)
+{
+    if (!is_current(cached, stroking)) {
+        path.points.swap(retained.path.points);
+        path.subpaths.swap(retained.path.subpaths);
+        std::vector<xy> placed;
+        if (!(retained.forward == forward)) {
+            placed = path.points;
+            for (size_t index = 0; index < path.points.size(); ++index)
+                path.points[index] = forward * (retained.inverse * placed[index]);
+        }
+        path_to_lines(stroking);
+        if (stroking)
+            stroke_lines();
+        if (!placed.empty())
+            path.points.swap(placed);
+        path.points.swap(retained.path.points);
+        path.subpaths.swap(retained.path.subpaths);
+        lines_to_runs(xy(0.0f, 0.0f), 0);
+        cached.lines.points.swap(lines.points);
+        cached.lines.subpaths.swap(lines.subpaths);
+        cached.runs.swap(runs);
+        cached.transform = forward;
+        cached.size_x = size_x;
+        cached.size_y = size_y;
+        cached.line_width = line_width;
+        cached.miter_limit = miter_limit;
+        cached.line_dash_offset = line_dash_offset;
+        cached.line_cap = line_cap;
+        cached.line_join = line_join;
+        cached.line_dash = line_dash;
+        cached.valid = true;
+        cached.stamps.clear();
+        cached.stamped.clear();
+    }
+}
+
+// Fill or stroke a retained path, reusing its cached polylines and runs
+// where possible.  The cached polylines are only needed for the shadow,
+// which renders from its own offset runs.  Since the polylines and runs are
+// swapped in and out rather than copied, drawing from the cache costs no
+// more than the compositing.
+//
+void canvas::render_retained(
+    retained_path& retained,
+    retained_path::coverage& cached,
+    paint_brush const& brush,
+    bool stroking)
+{
+    if (forward.a * forward.d - forward.b * forward.c == 0.0f)
+        return;
+    update_retained(retained, cached, stroking);
+    lines.points.swap(cached.lines.points);
+    lines.subpaths.swap(cached.lines.subpaths);
+    render_shadow(brush);
+    lines.points.swap(cached.lines.points);
+    lines.subpaths.swap(cached.lines.subpaths);
+    runs.swap(cached.runs);
+    render_coverage(brush);
+    runs.swap(cached.runs);
+}
+
+// Fill or stroke copies of a retained path at many offsets.  Each offset is
+// mapped through the linear part of the transform into canvas space, where
+// it is split into whole pixels and a fractional part rounded to quarter
+// pixels.  The cached polylines are scan-converted once per quarter pixel
+// step, relative to the integer corner of their bounds and with enough
+// padding that nothing is clipped away, and kept as stamps.  Each copy then
+// shifts the runs of its stamp by its whole pixel offset into the current
+// runs, dropping rows off the canvas and pinning columns to its edges,
+// which keeps them sorted and leaves the coverage on the canvas unchanged.
+// Shadows need the shifted polylines as well.
+//
+void canvas::render_instances(
+    retained_path& retained,
+    retained_path::coverage& cached,
+    paint_brush const& brush,
+    bool stroking,
+    float const* positions,
+    int count)
+{
+    static int const steps = 4;
+    if (forward.a * forward.d - forward.b * forward.c == 0.0f || !positions)
+        return;
+    update_retained(retained, cached, stroking);
+    if (cached.lines.points.empty())
+        return;
+    if (cached.stamps.empty()) {
+        xy low = cached.lines.points.front();
+        xy high = low;
+        for (size_t index = 1; index < cached.lines.points.size(); ++index) {
+            xy point = cached.lines.points[index];
+            low = xy(std::min(low.x, point.x), std::min(low.y, point.y));
+            high = xy(std::max(high.x, point.x), std::max(high.y, point.y));
+        }
+        cached.origin_x = static_cast<int>(floorf(low.x));
+        cached.origin_y = static_cast<int>(floorf(low.y));
+        int extent = std::max(static_cast<int>(ceilf(high.x)) - cached.origin_x - size_x,
+            static_cast<int>(ceilf(high.y)) - cached.origin_y - size_y);
+        cached.padding = std::max(extent, 0) + 1;
+        cached.stamps.resize(steps * steps);
+        cached.stamped.assign(steps * steps, false);
+    }
+    bool shadowing = shadow_color.a != 0.0f;
+    for (int instance = 0; instance < count; ++instance) {
+        float offset_x = positions[2 * instance];
+        float offset_y = positions[2 * instance + 1];
+        xy place = xy(static_cast<float>(cached.origin_x) + forward.a * offset_x + forward.c * offset_y,
+            static_cast<float>(cached.origin_y) + forward.b * offset_x + forward.d * offset_y);
+        xy whole = xy(floorf(place.x), floorf(place.y));
+        int step_x = static_cast<int>((place.x - whole.x) * steps + 0.5f);
+        int step_y = static_cast<int>((place.y - whole.y) * steps + 0.5f);
+        int shift_x = static_cast<int>(whole.x) + step_x / steps;
+        int shift_y = static_cast<int>(whole.y) + step_y / steps;
+        step_x %= steps;
+        step_y %= steps;
+        size_t stamp = static_cast<size_t>(step_y * steps + step_x);
+        xy fraction = (1.0f / steps) * xy(static_cast<float>(step_x), static_cast<float>(step_y));
+        if (!cached.stamped[stamp]) {
+            lines.points.swap(cached.lines.points);
+            lines.subpaths.swap(cached.lines.subpaths);
+            lines_to_runs(fraction - xy(static_cast<float>(cached.origin_x),
+                                         static_cast<float>(cached.origin_y)),
+                cached.padding);
+            lines.points.swap(cached.lines.points);
+            lines.subpaths.swap(cached.lines.subpaths);
+            cached.stamps[stamp].swap(runs);
+            cached.stamped[stamp] = true;
+        }
+        if (shadowing) {
+            xy shift = xy(static_cast<float>(shift_x - cached.origin_x),
+                           static_cast<float>(shift_y - cached.origin_y))
+                + fraction;
+            lines.points.clear();
+            for (size_t index = 0; index < cached.lines.points.size(); ++index)
+                lines.points.push_back(cached.lines.points[index] + shift);
+            lines.subpaths = cached.lines.subpaths;
+            render_shadow(brush);
+        }
+        pixel_runs const& source = cached.stamps[stamp];
+        runs.clear();
+        for (size_t index = 0; index < source.size(); ++index) {
+            int y = source[index].y + shift_y;
+            if (y < 0 || size_y <= y)
+                continue;
+            int x = std::min(std::max(source[index].x + shift_x, 0), size_x);
+            pixel_run piece = { static_cast<unsigned short>(x),
+                static_cast<unsigned short>(y), source[index].delta };
+            runs.push_back(piece);
+        }
+        render_coverage(brush);
+    }
+}
+
 canvas::canvas(
     int width,
     int height)
@@ -2618,6 +4418,7 @@ canvas::canvas(
     , line_cap(butt)
     , line_join(miter)
     , line_dash_offset(0.0f)
+    , image_filter(bicubic)
     , text_align(start)
     , text_baseline(alphabetic)
     , size_x(width)
@@ -2629,9 +4430,72 @@ canvas::canvas(
     , fill_brush()
     , stroke_brush()
     , image_brush()
+    , clipped(false)
     , face()
+    , glyphs()
+    , glyph_bytes(0)
+    , glyph_uses(0)
+#ifdef CANVAS_ITY_COMPACT_BITMAP
+    , bitmap(0)
+    , target(new unsigned char[width * height * 4]())
+    , target_stride(width * 4)
+    , owns_target(true)
+#else
     , bitmap(new rgba[width * height])
+    , target(0)
+    , target_stride(0)
+    , owns_target(false)
+#endif
+    , workers(0)
+    , saves(0)
+    , spares(0)
+{
+    initialize();
+}
+
+canvas::canvas(
+    int width,
+    int height,
+    unsigned char* image,
+    int stride)
+    : global_composite_operation(source_over)
+    , shadow_offset_x(0.0f)
+    , shadow_offset_y(0.0f)
+    , line_cap(butt)
+    , line_join(miter)
+    , line_dash_offset(0.0f)
+    , image_filter(bicubic)
+    , text_align(start)
+    , text_baseline(alphabetic)
+    , size_x(width)
+    , size_y(height)
+    , global_alpha(1.0f)
+    , shadow_blur(0.0f)
+    , line_width(1.0f)
+    , miter_limit(10.0f)
+    , fill_brush()
+    , stroke_brush()
+    , image_brush()
+    , clipped(false)
+    , face()
+    , glyphs()
+    , glyph_bytes(0)
+    , glyph_uses(0)
+    , bitmap(0)
+    , target(image)
+    , target_stride(stride)
+    , owns_target(false)
+    , workers(0)
     , saves(0)
+    , spares(0)
+{
+    initialize();
+}
+
+// Shared setup for both constructors: identity transforms, opaque black
+// brushes, and a clip mask covering the whole canvas.
+//
+void canvas::initialize()
 {
     affine_matrix identity = { 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f };
     forward = identity;
@@ -2650,11 +4514,72 @@ canvas::canvas(
 canvas::~canvas()
 {
     delete[] bitmap;
+    if (owns_target)
+        delete[] target;
+#ifdef CANVAS_ITY_THREADS
+    delete workers;
+#endif
     while (canvas* head = saves) {
         saves = head->saves;
         head->saves = 0;
         delete head;
     }
+    while (canvas* head = spares) {
+        spares = head->saves;
+        head->saves = 0;
+        delete head;
+    }
+}
+
+void canvas::set_thread_count(
+    int count)
+{
+#ifdef CANVAS_ITY_THREADS
+    delete workers;
+    workers = count > 1 ? new worker_pool(count - 1) : 0;
+#else
+    static_cast<void>(count);
+#endif
+}
+
+void canvas::reserve_scratch()
+{
+    size_t perimeter = static_cast<size_t>(size_x + size_y);
+    scratch_sizes sizes;
+    sizes.points = perimeter;
+    sizes.subpaths = 16;
+    sizes.runs = 8 * static_cast<size_t>(size_y) + mask.size();
+    sizes.counts = static_cast<size_t>(std::max(size_x, size_y)) + 3;
+    sizes.shadow = 0;
+    reserve_scratch(sizes);
+}
+
+void canvas::reserve_scratch(
+    scratch_sizes const& sizes)
+{
+    path.points.reserve(sizes.points);
+    lines.points.reserve(sizes.points);
+    scratch.points.reserve(sizes.points);
+    path.subpaths.reserve(sizes.subpaths);
+    lines.subpaths.reserve(sizes.subpaths);
+    scratch.subpaths.reserve(sizes.subpaths);
+    runs.reserve(sizes.runs);
+    run_buffer.reserve(sizes.runs);
+    run_counts.reserve(sizes.counts);
+    shadow.reserve(sizes.shadow);
+}
+
+scratch_sizes canvas::scratch_high_water() const
+{
+    scratch_sizes sizes;
+    sizes.points = std::max(path.points.capacity(),
+        std::max(lines.points.capacity(), scratch.points.capacity()));
+    sizes.subpaths = std::max(path.subpaths.capacity(),
+        std::max(lines.subpaths.capacity(), scratch.subpaths.capacity()));
+    sizes.runs = std::max(runs.capacity(), run_buffer.capacity());
+    sizes.counts = run_counts.capacity();
+    sizes.shadow = shadow.capacity();
+    return sizes;
 }
 
 void canvas::scale(
@@ -2794,6 +4719,8 @@ void canvas::set_linear_gradient(
     brush.type = paint_brush::linear;
     brush.colors.clear();
     brush.stops.clear();
+    brush.table.clear();
+    brush.kinks.clear();
     brush.start = xy(start_x, start_y);
     brush.end = xy(end_x, end_y);
 }
@@ -2813,6 +4740,8 @@ void canvas::set_radial_gradient(
     brush.type = paint_brush::radial;
     brush.colors.clear();
     brush.stops.clear();
+    brush.table.clear();
+    brush.kinks.clear();
     brush.start = xy(start_x, start_y);
     brush.end = xy(end_x, end_y);
     brush.start_radius = start_radius;
@@ -2836,6 +4765,7 @@ void canvas::add_color_stop(
     rgba color = linearized(clamped(rgba(red, green, blue, alpha)));
     brush.colors.insert(brush.colors.begin() + index, color);
     brush.stops.insert(brush.stops.begin() + index, offset);
+    tabulate(brush);
 }
 
 void canvas::set_pattern(
@@ -2854,10 +4784,7 @@ void canvas::set_pattern(
     for (int y = 0; y < height; ++y)
         for (int x = 0; x < width; ++x) {
             int index = y * stride + x * 4;
-            rgba color = rgba(
-                image[index + 0] / 255.0f, image[index + 1] / 255.0f,
-                image[index + 2] / 255.0f, image[index + 3] / 255.0f);
-            brush.colors.push_back(premultiplied(linearized(color)));
+            brush.colors.push_back(premultiplied(linearized(&image[index])));
         }
     brush.width = width;
     brush.height = height;
@@ -3051,6 +4978,46 @@ void canvas::stroke()
     render_main(stroke_brush);
 }
 
+void canvas::retain_path(
+    retained_path& retained) const
+{
+    retained.path = path;
+    retained.forward = forward;
+    retained.inverse = inverse;
+    retained.filled.valid = false;
+    retained.stroked.valid = false;
+}
+
+void canvas::fill(
+    retained_path& retained)
+{
+    render_retained(retained, retained.filled, fill_brush, false);
+}
+
+void canvas::stroke(
+    retained_path& retained)
+{
+    render_retained(retained, retained.stroked, stroke_brush, true);
+}
+
+void canvas::fill(
+    retained_path& retained,
+    float const* positions,
+    int count)
+{
+    render_instances(retained, retained.filled, fill_brush, false,
+        positions, count);
+}
+
+void canvas::stroke(
+    retained_path& retained,
+    float const* positions,
+    int count)
+{
+    render_instances(retained, retained.stroked, stroke_brush, true,
+        positions, count);
+}
+
 void canvas::clip()
 {
     path_to_lines(false);
@@ -3088,6 +5055,11 @@ void canvas::clip()
         }
         last = visibility;
     }
+    clipped = mask.size() != 2 * static_cast<size_t>(size_y);
+    for (size_t index = 0; !clipped && index < mask.size(); index += 2)
+        clipped = !(mask[index].x == 0 && mask[index].delta == 1.0f &&
+            mask[index + 1].x == size_x && mask[index + 1].delta == -1.0f &&
+            mask[index].y == index / 2 && mask[index + 1].y == index / 2);
 }
 
 bool canvas::is_point_in_path(
@@ -3192,6 +5164,8 @@ bool canvas::set_font(
 {
     if (font && bytes) {
         face.data.clear();
+        glyphs.clear();
+        glyph_bytes = 0;
         face.cmap = 0;
         face.glyf = 0;
         face.head = 0;
@@ -3342,7 +5316,7 @@ void canvas::get_image_data(
             int canvas_y = y + image_y;
             rgba color = rgba(0.0f, 0.0f, 0.0f, 0.0f);
             if (0 <= canvas_x && canvas_x < size_x && 0 <= canvas_y && canvas_y < size_y)
-                color = bitmap[canvas_y * size_x + canvas_x];
+                color = read_pixel(canvas_x, canvas_y);
             float threshold = bayer[canvas_y & 3][canvas_x & 3];
             color = rgba(threshold, threshold, threshold, threshold) + 255.0f * delinearized(clamped(unpremultiplied(color)));
             image[index + 0] = static_cast<unsigned char>(color.r);
@@ -3369,22 +5343,29 @@ void canvas::put_image_data(
             int canvas_y = y + image_y;
             if (canvas_x < 0 || size_x <= canvas_x || canvas_y < 0 || size_y <= canvas_y)
                 continue;
-            rgba color = rgba(
-                image[index + 0] / 255.0f, image[index + 1] / 255.0f,
-                image[index + 2] / 255.0f, image[index + 3] / 255.0f);
-            bitmap[canvas_y * size_x + canvas_x] = premultiplied(linearized(color));
+            write_pixel(canvas_x, canvas_y, premultiplied(linearized(&image[index])));
         }
 }
 
+// Saved states are whole canvases of size zero, chained through their saves
+// pointer.  Restored states are kept on a separate chain of spares rather
+// than deleted, so that saving again reuses one along with the capacity of
+// its vectors instead of going back to the heap.
+//
 void canvas::save()
 {
-    canvas* state = new canvas(0, 0);
+    canvas* state = spares;
+    if (state)
+        spares = state->saves;
+    else
+        state = new canvas(0, 0);
     state->global_composite_operation = global_composite_operation;
     state->shadow_offset_x = shadow_offset_x;
     state->shadow_offset_y = shadow_offset_y;
     state->line_cap = line_cap;
     state->line_join = line_join;
     state->line_dash_offset = line_dash_offset;
+    state->image_filter = image_filter;
     state->text_align = text_align;
     state->text_baseline = text_baseline;
     state->forward = forward;
@@ -3398,6 +5379,7 @@ void canvas::save()
     state->fill_brush = fill_brush;
     state->stroke_brush = stroke_brush;
     state->mask = mask;
+    state->clipped = clipped;
     state->face = face;
     state->saves = saves;
     saves = state;
@@ -3414,6 +5396,7 @@ void canvas::restore()
     line_cap = state->line_cap;
     line_join = state->line_join;
     line_dash_offset = state->line_dash_offset;
+    image_filter = state->image_filter;
     text_align = state->text_align;
     text_baseline = state->text_baseline;
     forward = state->forward;
@@ -3427,10 +5410,15 @@ void canvas::restore()
     fill_brush = state->fill_brush;
     stroke_brush = state->stroke_brush;
     mask = state->mask;
+    clipped = state->clipped;
+    if (state->face.data != face.data) {
+        glyphs.clear();
+        glyph_bytes = 0;
+    }
     face = state->face;
     saves = state->saves;
-    state->saves = 0;
-    delete state;
+    state->saves = spares;
+    spares = state;
 }
 
 }
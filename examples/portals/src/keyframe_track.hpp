@@ -0,0 +1,59 @@
+#ifndef KEYFRAME_TRACK_HPP
+#define KEYFRAME_TRACK_HPP
+#include "utils/math.hpp"
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+struct Keyframe {
+    float time { 0 }; // Normalized, 0 is the start of the track and 1 the end
+    pos2 pos { 0, 0 };
+    float rotation { 0 };
+};
+
+// Sequence of poses with an easing applied between each pair of neighbouring
+// keyframes. Keyframes must be sorted by time.
+class KeyframeTrack {
+public:
+    using Easing = float (*)(float);
+
+    KeyframeTrack() = default;
+    KeyframeTrack(std::vector<Keyframe> keyframes, Easing easing)
+        : m_keyframes(std::move(keyframes))
+        , m_easing(easing)
+    {
+    }
+
+    [[nodiscard]] bool empty() const { return m_keyframes.empty(); }
+
+    [[nodiscard]] Keyframe sample(float t) const
+    {
+        if (m_keyframes.size() == 1 || t <= m_keyframes.front().time) {
+            return m_keyframes.front();
+        }
+        if (t >= m_keyframes.back().time) {
+            return m_keyframes.back();
+        }
+
+        auto const next = std::ranges::upper_bound(m_keyframes, t, {}, &Keyframe::time);
+        auto const& to = *next;
+        auto const& from = *(next - 1);
+
+        float const span = to.time - from.time;
+        float const eased = m_easing((t - from.time) / span);
+        return {
+            .time = t,
+            .pos = {
+                from.pos.x + (to.pos.x - from.pos.x) * eased,
+                from.pos.y + (to.pos.y - from.pos.y) * eased,
+            },
+            .rotation = from.rotation + (to.rotation - from.rotation) * eased,
+        };
+    }
+
+private:
+    std::vector<Keyframe> m_keyframes;
+    Easing m_easing { nullptr };
+};
+
+#endif // KEYFRAME_TRACK_HPP
@@ -1,5 +1,6 @@
 #include "portal.hpp"
 #include <algorithm>
+#include <utility>
 
 surface Portal::calculate_surface() const
 {
@@ -26,29 +27,81 @@ vec2 Portal::normal() const
     };
 }
 
-// void Portal::update_position(float delta)
-// {
-//     if (m_is_reversing) {
-//         m_time_accumulator -= delta; // Decrease time if reversing
-//     } else {
-//         m_time_accumulator += delta; // Increase time otherwise
-//     }
-//
-//     // Clamp time accumulator to be within the 0 to movement duration range
-//     m_time_accumulator = std::max(0.0F, std::min(m_time_accumulator, m_movement_duration));
-//
-//     // Calculate interpolation factor (between 0.0 and 1.0)
-//     float t = m_time_accumulator / m_movement_duration;
-//
-//     // Apply cubic easing function
-//     float eased_t = ease_in_out_sine(t);
-//
-//     // Linearly interpolate the position based on the eased factor eased_t
-//     m_pos.x = (1 - eased_t) * m_start_pos.x + eased_t * m_end_pos.x;
-//     m_pos.y = (1 - eased_t) * m_start_pos.y + eased_t * m_end_pos.y;
-//
-//     // If time accumulates past the movement duration, reverse direction
-//     if (m_time_accumulator == 0.0F || m_time_accumulator == m_movement_duration) {
-//         m_is_reversing = !m_is_reversing; // Toggle reversing state
-//     }
-// }
+void Portal::set_track(KeyframeTrack track)
+{
+    m_track = std::move(track);
+    m_time_accumulator = 0.F;
+    m_is_reversing = false;
+    if (m_track.empty()) {
+        return;
+    }
+
+    auto const start = m_track.sample(0.F);
+    m_pos = m_prev_pos = start.pos;
+    m_rotation = m_prev_rotation = start.rotation;
+    m_velocity = { 0, 0 };
+}
+
+void Portal::update_position(float delta)
+{
+    m_prev_pos = m_pos;
+    m_prev_rotation = m_rotation;
+    if (m_track.empty() || delta <= 0.F) {
+        m_velocity = { 0, 0 };
+        return;
+    }
+
+    if (m_is_reversing) {
+        m_time_accumulator -= delta; // Decrease time if reversing
+    } else {
+        m_time_accumulator += delta; // Increase time otherwise
+    }
+
+    // Clamp time accumulator to be within the 0 to movement duration range
+    m_time_accumulator = std::clamp(m_time_accumulator, 0.F, m_movement_duration);
+
+    auto const pose = m_track.sample(m_time_accumulator / m_movement_duration);
+    m_pos = pose.pos;
+    m_rotation = pose.rotation;
+    m_velocity = {
+        (m_pos.x - m_prev_pos.x) / delta,
+        (m_pos.y - m_prev_pos.y) / delta,
+    };
+
+    // If time accumulates past the movement duration, reverse direction
+    if (m_time_accumulator == 0.0F || m_time_accumulator == m_movement_duration) {
+        m_is_reversing = !m_is_reversing; // Toggle reversing state
+    }
+}
+
+// Position of a point in the frame of a portal pose, x along the major axis
+// and y along the normal.
+static vec2 to_local(pos2 point, pos2 center, float rotation)
+{
+    return vec2_rotate({ point.x - center.x, point.y - center.y }, -rotation);
+}
+
+Portal::Crossing Portal::swept_crossing(pos2 ball_start, ball const& ball) const
+{
+    auto const from = to_local(ball_start, m_prev_pos, m_prev_rotation);
+    auto const to = to_local(ball.pos, m_pos, m_rotation);
+    if (from.y == to.y) {
+        return Crossing::NONE;
+    }
+
+    auto const within_span = [&](float plane) {
+        float const t = (from.y - plane) / (from.y - to.y);
+        float const x = from.x + (to.x - from.x) * t;
+        return std::abs(x) <= m_rad_x;
+    };
+
+    // Entering happens when the centre passes the portal plane from the front,
+    // the back is solid so the ball's edge is what hits it.
+    if (from.y >= 0.F && to.y < 0.F && within_span(0.F)) {
+        return Crossing::FRONT;
+    }
+    if (from.y <= -ball.r && to.y > -ball.r && within_span(-ball.r)) {
+        return Crossing::BACK;
+    }
+    return Crossing::NONE;
+}
@@ -7,6 +7,7 @@ extern "C" {
 #ifdef __cplusplus
 }
 #endif
+#include "keyframe_track.hpp"
 #include "utils/math.hpp"
 
 class Portal {
@@ -14,6 +15,8 @@ public:
     Portal() = default;
     Portal(pos2 pos, Color color, float rad_x, float rad_y, float rotation = 0.0F, float movement_duration = 1.F)
         : m_pos(pos)
+        , m_prev_pos(pos)
+        , m_prev_rotation(rotation)
         , m_color(color)
         , m_rad_x(rad_x)
         , m_rad_y(rad_y)
@@ -23,15 +26,31 @@ public:
     }
     [[nodiscard]] pos2 pos() const { return m_pos; }
     [[nodiscard]] vec2 pos_vec() const { return { m_pos.x, m_pos.y }; }
-    void set_pos(pos2 pos) { m_pos = pos; }
+    void set_pos(pos2 pos)
+    {
+        m_pos = pos;
+        m_prev_pos = pos;
+    }
     [[nodiscard]] Color color() const { return m_color; }
     [[nodiscard]] float rad_x() const { return m_rad_x; }
     [[nodiscard]] float rad_y() const { return m_rad_y; }
     [[nodiscard]] float rotation() const { return m_rotation; }
+    [[nodiscard]] vec2 velocity() const { return m_velocity; }
     [[nodiscard]] surface calculate_surface() const;
     [[nodiscard]] vec2 normal() const;
 
-    [[maybe_unused]] [[nodiscard]] float cubic_ease_in_out(float t) const
+    enum class Crossing {
+        NONE,
+        FRONT, // Entered the portal
+        BACK,  // Hit the solid back of the portal
+    };
+    // Swept test of a ball against the portal over the last step. Both ends of
+    // the ball's path are expressed relative to the portal's pose at that time,
+    // so a moving portal sweeping over a ball is caught the same way as a ball
+    // moving through a static one.
+    [[nodiscard]] Crossing swept_crossing(pos2 ball_start, ball const& ball) const;
+
+    [[nodiscard]] static float cubic_ease_in_out(float t)
     {
         if (t < 0.5F) {
             return 4 * t * t * t;
@@ -48,10 +67,16 @@ public:
     {
         return t;
     }
+    // Keyframe times are scaled by the movement duration
+    void set_track(KeyframeTrack track);
     void update_position(float delta);
 
 private:
-    pos2 m_pos { 0, 0 }; // End position
+    pos2 m_pos { 0, 0 };
+    pos2 m_prev_pos { 0, 0 }; // Pose at the start of the last step
+    float m_prev_rotation {};
+    vec2 m_velocity { 0, 0 };
+    KeyframeTrack m_track;
     float m_time_accumulator {};
     bool m_is_reversing { false };     // Flag to reverse direction
     float m_movement_duration { 0.5 }; // Duration from start to end
@@ -1,20 +1,15 @@
 #include "portals_chamber.hpp"
+#ifndef RENDER_LIVE
 #include "images.hpp"
+#endif
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <libchamber/exports.h>
+#include <libchamber/primitives.hpp>
 #include <libchamber/print.hpp>
 #include <ranges>
 
-void draw_line(canvas_ity::canvas& context, float x1, float y1, float x2, float y2)
-{
-    context.begin_path();
-    context.move_to(x1, y1);
-    context.line_to(x2, y2);
-    context.close_path();
-    context.set_color(canvas_ity::stroke_style, 0, 0, 0, 1.0F);
-    context.stroke();
-}
-
 void init(size_t max_num_balls, size_t max_canvas_size)
 {
     chamber::init<Portals>(max_num_balls, max_canvas_size);
@@ -43,12 +38,14 @@ void teleport_ball(ball& ball, Portal const& entrance, Portal const& exit)
     // Transform the ball's position
     ball.pos = transform_point_portal_to_portal(ball.pos, entrance, exit);
 
-    // Rotate the velocity to align with the exit portal's context
+    // Rotate the velocity relative to the entrance to align with the exit portal's context
     float angle_diff = exit.rotation() - entrance.rotation();
 
-    float vx = ball.velocity.x * std::cos(angle_diff) - ball.velocity.y * std::sin(angle_diff);
-    float vy = ball.velocity.x * std::sin(angle_diff) + ball.velocity.y * std::cos(angle_diff);
-    ball.velocity = { vx, vy };
+    vec2 const entrance_velocity = entrance.velocity();
+    vec2 const relative_velocity = vec2_sub(&ball.velocity, &entrance_velocity);
+    vec2 const rotated_velocity = vec2_rotate(relative_velocity, angle_diff);
+    vec2 const exit_velocity = exit.velocity();
+    ball.velocity = vec2_add(&rotated_velocity, &exit_velocity);
 
     vec2 exit_normal = exit.normal();
 
@@ -56,162 +53,205 @@ void teleport_ball(ball& ball, Portal const& entrance, Portal const& exit)
     ball.pos.x += exit_normal.x * ball.r * 2;
 }
 
-pos2 closest_point_on_segment(pos2 c, pos2 a, pos2 b)
+void bounce_off_back(ball& ball, Portal const& portal, float delta)
 {
-    vec2 ab = { b.x - a.x, b.y - a.y };
-    vec2 ac = { c.x - a.x, c.y - a.y };
-    float ab_ab = ab.x * ab.x + ab.y * ab.y; // Dot product of ab with itself
-    float ab_ac = ab.x * ac.x + ab.y * ac.y; // Dot product of ab with ac
-    float t = ab_ac / ab_ab;
-
-    // Clamp t from 0.0 to 1.0 to keep the projection within the segment
-    t = fmax(0.0, fmin(1.0, t));
-
-    // Compute the closest point
-    pos2 closest {};
-    closest.x = a.x + t * ab.x;
-    closest.y = a.y + t * ab.y;
-    return closest;
+    // Push the ball back out behind the portal plane, the portal's velocity is
+    // handed to the collision so a moving portal carries the ball with it.
+    vec2 const normal = portal.normal();
+    vec2 const back_normal = vec2_mul(&normal, -1.F);
+    pos2 const portal_pos = portal.pos();
+    vec2 const relative_pos = pos2_sub(&ball.pos, &portal_pos);
+    float const depth = vec2_dot(&relative_pos, &back_normal);
+    vec2 const resolution = vec2_mul(&back_normal, ball.r - depth);
+    vec2 const portal_velocity = portal.velocity();
+    apply_ball_collision(&ball, &resolution, &back_normal, &portal_velocity, delta, 0.90F);
 }
 
-bool check_collision(ball& b, surface& s)
+void Portals::step(size_t num_balls, float delta)
 {
-    // Calculate normal
-    vec2 normal = { s.b.y - s.a.y, s.a.x - s.b.x };
-
-    // Check if the ball is moving towards the normal
-    if (vec2_dot(&b.velocity, &normal) < 0) {
-        return false; // Not moving towards the surface from the correct side
-    }
-
-    // Find the closest point on the segment to the ball's center
-    pos2 closest = closest_point_on_segment(b.pos, s.a, s.b);
-
-    // Calculate distance from closest point on segment to ball center
-    float dx = closest.x - b.pos.x;
-    float dy = closest.y - b.pos.y;
-    float distance = sqrt(dx * dx + dy * dy);
-
-    // Check if the distance is less than or equal to the ball's radius
-    if (distance <= (b.r / 10.f)) {
-        return true;
+    m_step_start.resize(num_balls);
+    for (size_t i = 0; i < num_balls; ++i) {
+        m_step_start[i] = m_balls[i].pos;
     }
 
-    return false;
-}
-
-void Portals::step(size_t num_balls, float delta)
-{
     for (auto& ball : std::ranges::views::take(m_balls, num_balls)) {
         apply_gravity(&ball, delta);
     }
 
-    std::array<Portal, 2> portals = { m_blue_portal, m_orange_portal };
+    // Portals move once per step, before collision so the sweep covers the
+    // same interval as the balls
+    m_blue_portal.update_position(delta);
+    m_orange_portal.update_position(delta);
+
+    std::array<Portal const*, 2> portals = { &m_blue_portal, &m_orange_portal };
     for (size_t i = 0; i < num_balls; ++i) {
         ball* ball = &m_balls[i];
         for (size_t j = 0; j < portals.size(); ++j) {
-            auto const& entry_portal = portals.at(j);
-            auto const& exit_portal = portals.at((j + 1) % portals.size());
+            auto const& entry_portal = *portals.at(j);
+            auto const& exit_portal = *portals.at((j + 1) % portals.size());
 
-            auto surface_in = entry_portal.calculate_surface();
-            if (check_collision(*ball, surface_in)) {
+            auto const crossing = entry_portal.swept_crossing(m_step_start[i], *ball);
+            if (crossing == Portal::Crossing::FRONT) {
                 teleport_ball(*ball, entry_portal, exit_portal);
+                break;
+            }
+            if (crossing == Portal::Crossing::BACK) {
+                bounce_off_back(*ball, entry_portal, delta);
+                break;
             }
         }
     }
+}
 
-    // m_blue_portal.update_position(delta);
-    // m_orange_portal.update_position(delta);
+#ifndef RENDER_LIVE
+std::array<chamber::RotatedSprite, 2> Portals::load_portal_sprites()
+{
+    // Budgets follow the size the portals are drawn at, see render()
+    return {
+        chamber::RotatedSprite { chamber::Sprite { blue_portal_data, PORTAL_IMAGE_WIDTH, PORTAL_IMAGE_HEIGHT } },
+        chamber::RotatedSprite { chamber::Sprite { orange_portal_data, PORTAL_IMAGE_WIDTH, PORTAL_IMAGE_HEIGHT } },
+    };
 }
 
-void Portals::render(size_t canvas_width, size_t canvas_height)
+// Follows the portal's radius and the canvas width like the physics does
+vec2 Portals::sprite_size(Portal const& portal) const
 {
-    if (m_canvas_width == canvas_width && m_canvas_height == canvas_height) {
-        return;
-    }
-    m_canvas_width = canvas_width;
-    m_canvas_height = canvas_height;
+    float const width = 2.F * portal.rad_x() * m_viewport.scale() * PORTAL_IMAGE_WIDTH / PORTAL_IMAGE_SPAN;
+    return { width, width * PORTAL_IMAGE_HEIGHT / PORTAL_IMAGE_WIDTH };
+}
 
-    auto const fill_screen = [this](uint32_t color) {
-        for (size_t i = 0; i < m_canvas_width * m_canvas_height; ++i) {
-            m_canvas[i] = color;
-        }
-    };
-    fill_screen(0xFFFFFFFF);
-
-    // m_ctx.set_color(canvas_ity::fill_style, 1, 1, 1, 1.0F);
-    // m_ctx.fill_rectangle(0, 0, canvas_width, canvas_height);
-
-    draw_image(
-        blue_portal_data.data(),
-        140, 56,
-        (int)pix2pos_x(m_blue_portal.pos().x), (int)pix2pos_y(m_blue_portal.pos().y));
-
-    draw_image(
-        orange_portal_data.data(),
-        140, 56,
-        (int)pix2pos_x(m_orange_portal.pos().x), (int)pix2pos_y(m_orange_portal.pos().y));
-
-    //     std::array<Portal, 2> portals = { m_blue_portal, m_orange_portal };
-    //     for (auto const& portal : portals) {
-    //         auto const surf = portal.calculate_surface();
-    //         draw_line(m_ctx,
-    //             pix2pos_x(surf.a.x),
-    //             pix2pos_y(surf.a.y),
-    //             pix2pos_x(surf.b.x),
-    //             pix2pos_y(surf.b.y));
-    //     }
-    //
-    //     m_ctx.get_image_data(
-    //         reinterpret_cast<unsigned char*>(m_canvas.data()),
-    //         static_cast<int>(canvas_width), static_cast<int>(canvas_height),
-    //         static_cast<int>(canvas_width * 4),
-    //         0, 0);
+PixelRect Portals::sprite_rect(Portal const& portal, pos2 center, size_t index) const
+{
+    auto const [width, height] = sprite_size(portal);
+    return m_portal_sprites.at(index).rect(center, width, height, portal.rotation());
 }
+#endif
 
-void Portals::draw_image(uint32_t const* data, int image_width, int image_height, int x, int y)
+#ifdef RENDER_LIVE
+// Draws the portal as a glowing ring around a translucent ellipse, centered in
+// an image just large enough to hold it. Sizes are normalized to the canvas
+// width like positions are, so scale is the canvas width in pixels.
+Image render_portal_to_texture(Portal const& portal, float scale)
 {
-    vec2 middle = { image_width / 2.F, image_height / 2.F };
+    float const rad_x = std::max(portal.rad_x() * scale, 1.F);
+    float const rad_y = std::max(portal.rad_y() * scale, 1.F);
+    float const line_width = std::max(rad_y * 0.12F, 1.F);
+    float const glow = rad_y * 0.3F;
+    // The canvas y axis points down, so the portal turns the other way
+    float const rotation = -portal.rotation();
+    float const extent_x = std::hypot(rad_x * std::cos(rotation), rad_y * std::sin(rotation));
+    float const extent_y = std::hypot(rad_x * std::sin(rotation), rad_y * std::cos(rotation));
+    float const margin = line_width + 2.F * glow;
+    Image image(static_cast<int>(std::ceil(2.F * (extent_x + margin))), static_cast<int>(std::ceil(2.F * (extent_y + margin))));
+
+    // Drawing straight into the image leaves it premultiplied, ready to blit
+    canvas_ity::canvas context(image.width, image.height,
+        reinterpret_cast<unsigned char*>(image.pixels.data()),
+        image.width * static_cast<int>(sizeof(uint32_t)));
+    auto const [red, green, blue] = portal.color();
+    context.translate(static_cast<float>(image.width) * 0.5F, static_cast<float>(image.height) * 0.5F);
+    context.rotate(rotation);
+    context.scale(rad_x, rad_y);
+    context.begin_path();
+    context.arc(0, 0, 1, 0, 2.F * std::numbers::pi_v<float>);
+    context.set_radial_gradient(canvas_ity::fill_style, 0, 0, 0, 0, 0, 1);
+    context.add_color_stop(canvas_ity::fill_style, 0.F, red, green, blue, 0.F);
+    context.add_color_stop(canvas_ity::fill_style, 0.6F, red, green, blue, 0.1F);
+    context.add_color_stop(canvas_ity::fill_style, 1.F, red, green, blue, 0.5F);
+    context.fill();
+
+    // Stroke with an even width in pixels rather than in the squashed circle
+    context.set_transform(1, 0, 0, 1, 0, 0);
+    context.set_line_width(line_width);
+    context.set_shadow_color(red, green, blue, 1.F);
+    context.set_shadow_blur(glow);
+    context.set_color(canvas_ity::stroke_style, red, green, blue, 1.F);
+    context.stroke();
+    return image;
+}
 
-    for (int i = 0; i < image_width; ++i) {
-        for (int j = 0; j < image_height; ++j) {
-            int index = i + j * image_width;
+bool Portals::update_texture(PortalTexture& texture, Portal const& portal) const
+{
+    if (texture.color == portal.color() && texture.rad_x == portal.rad_x() && texture.rad_y == portal.rad_y()
+        && texture.rotation == portal.rotation() && texture.viewport == m_viewport) {
+        return false;
+    }
+    texture.image = render_portal_to_texture(portal, m_viewport.scale());
+    texture.color = portal.color();
+    texture.rad_x = portal.rad_x();
+    texture.rad_y = portal.rad_y();
+    texture.rotation = portal.rotation();
+    texture.viewport = m_viewport;
+    return true;
+}
+#endif
 
-            int x_pos = x - middle.x + i;
-            int y_pos = y - middle.y + j;
-            if (x_pos < 0 || x_pos >= m_canvas_width || y_pos < 0 || y_pos >= m_canvas_height) {
-                continue;
+void Portals::render(size_t canvas_width, size_t canvas_height)
+{
+    chamber::Viewport const viewport(canvas_width, canvas_height);
+    bool const resized = viewport != m_viewport;
+    m_viewport = viewport;
+
+    std::array<Portal const*, 2> const portals = { &m_blue_portal, &m_orange_portal };
+    std::array<pos2, 2> const positions = { m_blue_portal.pos(), m_orange_portal.pos() };
+    std::array<pos2, 2> centers {};
+    m_viewport.to_pixels(positions, centers);
+    std::array<PixelRect, 2> rects {};
+    std::array<bool, 2> restyled {}; // Looks changed even if the rect did not
+#ifdef RENDER_LIVE
+    for (size_t i = 0; i < portals.size(); ++i) {
+        auto& texture = m_portal_textures.at(i);
+        restyled.at(i) = update_texture(texture, *portals.at(i));
+        rects.at(i) = chamber::sprite_rect(centers.at(i), static_cast<float>(texture.image.width), static_cast<float>(texture.image.height));
+    }
+#else
+    for (size_t i = 0; i < portals.size(); ++i) {
+        auto const rect = sprite_rect(*portals.at(i), centers.at(i), i);
+        rects.at(i) = rect;
+        restyled.at(i) = portals.at(i)->rotation() != m_drawn_rotations.at(i);
+        m_drawn_rotations.at(i) = portals.at(i)->rotation();
+        // The portals mostly sit at one angle, so room for the copy drawn and
+        // a neighbour. The neighbour's corners are within two pixels of the
+        // drawn copy's, so it is at most four pixels larger each way. Both
+        // grow with the canvas and, towards 45 degrees, with the angle.
+        auto const copy_width = static_cast<size_t>(rect.right - rect.left) + 4;
+        auto const copy_height = static_cast<size_t>(rect.bottom - rect.top) + 4;
+        m_portal_sprites.at(i).set_budget(2 * copy_width * copy_height * sizeof(uint32_t));
+    }
+#endif
+
+    // Only the area a portal covered last frame and covers now has to be
+    // redrawn. Overlapping areas are merged so no pixel is blended twice.
+    std::array<PixelRect, 2> dirty {};
+    size_t num_dirty = 0;
+    if (resized) {
+        dirty.at(num_dirty++) = m_viewport.bounds();
+    } else {
+        for (size_t i = 0; i < rects.size(); ++i) {
+            if (restyled.at(i) || rects.at(i) != m_drawn_rects.at(i)) {
+                dirty.at(num_dirty++) = rects.at(i).united(m_drawn_rects.at(i));
             }
+        }
+        if (num_dirty == 2 && dirty[0].overlaps(dirty[1])) {
+            dirty[0] = dirty[0].united(dirty[1]);
+            num_dirty = 1;
+        }
+    }
+    m_drawn_rects = rects;
 
-            uint32_t src = data[index];
-            uint32_t dst = m_canvas.at(x_pos + y_pos * m_canvas_width);
-
-            uint8_t srcAlpha = (src >> 24) & 0xFF;
-            uint8_t srcRed = (src >> 16) & 0xFF;
-            uint8_t srcGreen = (src >> 8) & 0xFF;
-            uint8_t srcBlue = src & 0xFF;
-
-            uint8_t dstAlpha = (dst >> 24) & 0xFF;
-            uint8_t dstRed = (dst >> 16) & 0xFF;
-            uint8_t dstGreen = (dst >> 8) & 0xFF;
-            uint8_t dstBlue = dst & 0xFF;
-
-            // Perform alpha blending for each component
-            float srcAlphaNormalized = srcAlpha / 255.0f;
-            uint8_t newRed = srcRed * srcAlphaNormalized + dstRed * (1 - srcAlphaNormalized);
-            uint8_t newGreen = srcGreen * srcAlphaNormalized + dstGreen * (1 - srcAlphaNormalized);
-            uint8_t newBlue = srcBlue * srcAlphaNormalized + dstBlue * (1 - srcAlphaNormalized);
-            uint8_t newAlpha = dstAlpha; // Optionally, calculate the new alpha as well if needed
-
-            // Combine into a single uint32_t
-            uint32_t newColor = static_cast<uint32_t>((newAlpha << 24) | (newRed << 16) | (newGreen << 8) | newBlue);
-            if (x_pos + y_pos * m_canvas_width >= (m_canvas_width * m_canvas_height) * 4) {
-                continue;
-            }
-            // continue;
-            // m_canvas.at(x_pos + y_pos * m_canvas_width) = 0xFFFFFFFF;
-            // m_canvas.at(x_pos + y_pos * m_canvas_width) = 0x000000FF;
-            m_canvas.at(x_pos + y_pos * m_canvas_width) = newColor;
+    for (auto clip : std::ranges::views::take(dirty, num_dirty)) {
+        clip = m_viewport.clipped(clip);
+        if (clip.empty()) {
+            continue;
+        }
+        chamber::fill_rect(clip, 0xFFFFFFFF, clip, m_canvas, canvas_width);
+        for (size_t i = 0; i < portals.size(); ++i) {
+#ifdef RENDER_LIVE
+            blit(m_portal_textures.at(i).image, rects.at(i).left, rects.at(i).top, clip, m_canvas, canvas_width);
+#else
+            auto const [width, height] = sprite_size(*portals.at(i));
+            m_portal_sprites.at(i).draw(centers.at(i), width, height, portals.at(i)->rotation(), clip, m_canvas, canvas_width);
+#endif
         }
     }
 }
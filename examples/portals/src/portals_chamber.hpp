@@ -1,9 +1,16 @@
 #ifndef PORTALS_HPP
 #define PORTALS_HPP
 #include "portal.hpp"
-#include <canvas_ity/canvas_ity.hpp>
 #include <libchamber/chamber.hpp>
 #include <libchamber/print.hpp>
+#include <libchamber/sprite.hpp>
+#include <libchamber/viewport.hpp>
+#ifdef RENDER_LIVE
+#include "utils/image.hpp"
+#include <canvas_ity/canvas_ity.hpp>
+#endif
+#include <array>
+#include <vector>
 
 class Portals : public chamber::Chamber {
 public:
@@ -23,7 +30,6 @@ public:
 
     Portals(size_t max_balls, size_t max_canvas_size)
         : Chamber(max_balls, max_canvas_size)
-    //, m_ctx(compute_width_height(max_canvas_size).x, compute_width_height(max_canvas_size).y)
     {
         // m_blue_portal = Portal { { 0.805F, 0.25F }, { 0.805F, 0.25F }, { 0.0F, 0.7F, 1.0F }, 0.15F, 0.05F, deg2rad(30.F), 0.7F };
         // m_orange_portal = Portal { { 0.20F, 0.1F }, { 0.20F, 0.15F }, { 1.0F, 0.5F, 0.0F }, 0.15F, 0.05F, deg2rad(0), 0.5F };
@@ -33,12 +39,15 @@ public:
 
         m_blue_portal = Portal { { 0.5F + 0.002F, 0.595F }, { 0.0F, 0.7F, 1.0F }, 0.15F, 0.05F, deg2rad(0.F), 0.7F };
         m_orange_portal = Portal { { 0.5F + 0.002F, 0.1F }, { 1.0F, 0.5F, 0.0F }, 0.15F, 0.05F, deg2rad(0.F), 0.5F };
+        m_orange_portal.set_track(KeyframeTrack {
+            {
+                { .time = 0.F, .pos = { 0.35F, 0.1F }, .rotation = deg2rad(0.F) },
+                { .time = 1.F, .pos = { 0.65F, 0.1F }, .rotation = deg2rad(0.F) },
+            },
+            Portal::ease_in_out_sine });
 
-        auto const [max_canvas_width, max_canvas_height] = compute_width_height(max_canvas_size);
-
-#ifdef RENDER_LIVE
-        m_blue_portal_texture = render_portal_to_texture(m_ctx, max_canvas_width, max_canvas_height, m_blue_portal);
-        m_orange_portal_texture = render_portal_to_texture(m_ctx, max_canvas_width, max_canvas_height, m_orange_portal);
+#ifndef RENDER_LIVE
+        m_portal_sprites = load_portal_sprites();
 #endif
     }
 
@@ -47,33 +56,41 @@ public:
     void render(size_t canvas_width, size_t canvas_height) override;
 
 private:
-    [[nodiscard]] float pix2pos_x(float x_norm) const
-    {
-        return x_norm * static_cast<float>(m_canvas_width);
-    }
-    [[nodiscard]] float pix2pos_y(float y_norm) const
-    {
-        return static_cast<float>(m_canvas_height) - y_norm * static_cast<float>(m_canvas_width);
-    }
-    [[nodiscard]] pos2 pix2pos(pos2 pos_norm) const
-    {
-        return {
-            pix2pos_x(pos_norm.x),
-            pix2pos_y(pos_norm.y)
-        };
-    }
+    static constexpr int PORTAL_IMAGE_WIDTH = 140;
+    static constexpr int PORTAL_IMAGE_HEIGHT = 56;
+    static constexpr float PORTAL_IMAGE_SPAN = 102.F; // Pixels of the images the major axis spans
 
-    void draw_image(uint32_t const* data, int image_width, int image_height, int x, int y);
-
-    // canvas_ity::canvas m_ctx;
     Portal m_blue_portal;
     Portal m_orange_portal;
+    std::vector<pos2> m_step_start; // Ball positions before the current step
+    std::array<PixelRect, 2> m_drawn_rects {};
+#ifndef RENDER_LIVE
+    static std::array<chamber::RotatedSprite, 2> load_portal_sprites();
+    // Size on the canvas that the portal's image is drawn at, before turning
+    [[nodiscard]] vec2 sprite_size(Portal const& portal) const;
+    [[nodiscard]] PixelRect sprite_rect(Portal const& portal, pos2 center, size_t index) const;
+
+    std::array<chamber::RotatedSprite, 2> m_portal_sprites;
+    std::array<float, 2> m_drawn_rotations {};
+#endif
 #ifdef RENDER_LIVE
-    Image m_blue_portal_texture;
-    Image m_orange_portal_texture;
+    // Portal rendered with canvas_ity, along with what it was rendered from.
+    // Moving a portal only blits it somewhere else, it is rendered again only
+    // once the canvas size or the portal's looks change.
+    struct PortalTexture {
+        Image image;
+        Color color {};
+        float rad_x {};
+        float rad_y {};
+        float rotation {};
+        chamber::Viewport viewport;
+    };
+    // Renders the texture again if it is stale, returns whether it did
+    bool update_texture(PortalTexture& texture, Portal const& portal) const;
+
+    std::array<PortalTexture, 2> m_portal_textures;
 #endif
-    size_t m_canvas_width {};
-    size_t m_canvas_height {};
+    chamber::Viewport m_viewport;
 };
 
 #endif // PORTALS_HPP
@@ -1,5 +1,5 @@
-#ifndef IMAGE_HPP
-#define IMAGE_HPP
+#ifndef CANVAS_HPP
+#define CANVAS_HPP
 #include "math.hpp"
 #include <vector>
 
@@ -10,4 +10,4 @@
 class Canvas {
 };
 
-#endif // IMAGE_HPP
+#endif // CANVAS_HPP
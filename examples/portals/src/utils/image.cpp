@@ -0,0 +1,17 @@
+#include "image.hpp"
+#include <libchamber/sprite.hpp>
+
+void blit(Image const& image, int left, int top, PixelRect clip, std::span<uint32_t> canvas, size_t canvas_width)
+{
+    PixelRect const visible = PixelRect { left, top, left + image.width, top + image.height }.intersected(clip);
+    if (visible.empty()) {
+        return;
+    }
+
+    auto const count = static_cast<size_t>(visible.right - visible.left);
+    for (int y = visible.top; y < visible.bottom; ++y) {
+        auto const source = static_cast<size_t>(y - top) * static_cast<size_t>(image.width) + static_cast<size_t>(visible.left - left);
+        auto const target = static_cast<size_t>(y) * canvas_width + static_cast<size_t>(visible.left);
+        chamber::blend_over(canvas.subspan(target, count), std::span(image.pixels).subspan(source, count));
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef IMAGE_HPP
+#define IMAGE_HPP
+#include "math.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Premultiplied sRGB RGBA8 pixels in rows from the top, packed into uint32_t
+// the same way as the chamber canvas so they can be blitted onto it as is
+struct Image {
+    Image() = default;
+    Image(int image_width, int image_height)
+        : width(image_width)
+        , height(image_height)
+        , pixels(static_cast<size_t>(image_width) * static_cast<size_t>(image_height))
+    {
+    }
+
+    [[nodiscard]] bool empty() const { return pixels.empty(); }
+
+    int width { 0 };
+    int height { 0 };
+    std::vector<uint32_t> pixels;
+};
+
+// Composites the image over the canvas with its upper left corner at (left,
+// top), touching only the pixels inside clip
+void blit(Image const& image, int left, int top, PixelRect clip, std::span<uint32_t> canvas, size_t canvas_width);
+
+#endif // IMAGE_HPP
@@ -1,5 +1,6 @@
 #ifndef MATH_HPP
 #define MATH_HPP
+#include <algorithm>
 #include <cmath>
 #ifdef __cplusplus
 extern "C" {
@@ -8,6 +9,7 @@ extern "C" {
 #ifdef __cplusplus
 }
 #endif
+#include <libchamber/pixel_rect.hpp>
 #include <numbers>
 
 inline vec2 vec2_reflect(vec2 v, vec2 n)
@@ -41,10 +43,13 @@ struct bounds {
     float bottom;
 };
 
+using chamber::PixelRect;
+
 struct Color {
     float r { 0 };
     float g { 0 };
     float b { 0 };
+    bool operator==(Color const&) const = default;
 };
 
 #endif // MATH_HPP
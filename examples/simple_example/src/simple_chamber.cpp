@@ -1,5 +1,9 @@
+#include <libchamber/ballistic.hpp>
 #include <libchamber/chamber.hpp>
 #include <libchamber/exports.h>
+#include <libchamber/primitives.hpp>
+#include <libchamber/sleep.hpp>
+#include <libchamber/viewport.hpp>
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -7,7 +11,7 @@ extern "C" {
 #ifdef __cplusplus
 }
 #endif
-#include <ranges>
+#include <span>
 
 class Simple : public chamber::Chamber {
 public:
@@ -19,51 +23,70 @@ public:
             .a = { 0.2F, 0.5F },
             .b = { 0.8F, 0.5F },
         };
+#ifdef EVENT_DRIVEN
+        m_engine.add_surface(m_surface);
+#else
+        // Fast balls would otherwise pass through the surface within one step
+        static constexpr float MAX_TRAVEL = 0.5F;
+        static constexpr int MAX_SUBSTEPS = 8;
+        set_adaptive_step(MAX_TRAVEL, MAX_SUBSTEPS);
+#endif
     }
 
     void step(size_t num_balls, float delta) override
     {
-        for (auto& ball : std::ranges::views::take(m_balls, num_balls)) {
-            apply_gravity(&ball, delta);
+#ifdef EVENT_DRIVEN
+        m_engine.step(std::span(m_balls).first(num_balls), delta);
+#else
+        auto const balls = std::span(m_balls).first(num_balls);
+
+        for (auto const i : m_sleep.awake()) {
+            apply_gravity(&balls[i], delta);
         }
 
-        for (auto& ball : std::ranges::views::take(m_balls, num_balls)) {
+        for (auto const i : m_sleep.awake()) {
+            auto& ball = balls[i];
             vec2 res {};
             if (surface_collision_resolution(&m_surface, &ball.pos, &ball.velocity, &res)) {
                 auto surf_normal = surface_normal(&m_surface);
                 vec2 zero = { 0, 0 };
                 apply_ball_collision(&ball, &res, &surf_normal, &zero, delta, 0.90F);
+                // Pushed up out of the surface, so resting on it
+                if (res.y > 0.F) {
+                    m_sleep.mark_supported(i);
+                }
             }
         }
+
+        m_sleep.end_step(balls, delta);
+#endif
     }
 
     void render(size_t canvas_width, size_t canvas_height) override
     {
-        if (m_prev_canvas_width == canvas_width && m_prev_canvas_height == canvas_height) {
+        chamber::Viewport const viewport(canvas_width, canvas_height);
+        if (viewport == m_viewport) {
             return;
         }
-        m_prev_canvas_width = canvas_width;
-        m_prev_canvas_height = canvas_height;
-
-        auto const draw_horizontal_line = [&](int x1, int x2, int y) {
-            for (int i = x1; i < x2; i++) {
-                m_canvas[i + y * canvas_width] = 0xFF000000;
-            }
-        };
-        auto const pos2pix_x = [&](float x_norm) {
-            return x_norm * static_cast<float>(canvas_width);
-        };
-        auto const pos2pix_y = [&](float y_norm) {
-            return static_cast<float>(canvas_height) - y_norm * static_cast<float>(canvas_width);
-        };
+        m_viewport = viewport;
 
-        draw_horizontal_line(pos2pix_x(m_surface.a.x), pos2pix_x(m_surface.b.x), pos2pix_y(m_surface.a.y));
+        chamber::draw_line(m_viewport.to_pixels(m_surface.a), m_viewport.to_pixels(m_surface.b), 0xFF000000,
+            m_viewport.bounds(), m_canvas, canvas_width);
     }
 
+protected:
+#ifndef EVENT_DRIVEN
+    [[nodiscard]] chamber::SleepTracker* sleep_tracker() override { return &m_sleep; }
+#endif
+
 private:
     surface m_surface;
-    size_t m_prev_canvas_width;
-    size_t m_prev_canvas_height;
+#ifdef EVENT_DRIVEN
+    chamber::BallisticEngine m_engine { 0.90F };
+#else
+    chamber::SleepTracker m_sleep;
+#endif
+    chamber::Viewport m_viewport;
 };
 
 void init(size_t max_num_balls, size_t max_canvas_size)
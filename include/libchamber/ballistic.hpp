@@ -0,0 +1,87 @@
+#ifndef BALLISTIC_HPP
+#define BALLISTIC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <libphysics/physics.h>
+#ifdef __cplusplus
+}
+#endif
+#include <functional>
+#include <queue>
+#include <span>
+#include <vector>
+
+namespace chamber {
+
+// Event driven alternative to integrating every ball every step.
+//
+// Between contacts a ball follows an exact parabola, so each ball only keeps
+// the state of its last event and the analytically solved time of its next
+// one (impact with a surface, or sliding off the end of the surface it rests
+// on). A step pops the events that are due and evaluates the remaining balls
+// in closed form. Only ball/surface contacts are handled, ball/ball
+// collisions and surface end caps are not.
+class BallisticEngine {
+public:
+    // Matches the acceleration applied by apply_gravity
+    static constexpr float GRAVITY = -9.832F;
+    // Below this normal speed a bounce turns into resting contact
+    static constexpr float REST_SPEED = 0.05F;
+
+    explicit BallisticEngine(float elasticity)
+        : m_elasticity(elasticity)
+    {
+    }
+
+    void add_surface(surface const& surface) { m_surfaces.push_back(surface); }
+
+    // Advances time by delta and writes the balls' state back. Balls that
+    // were modified since the last step (e.g. by the host) restart from the
+    // state they were given.
+    void step(std::span<ball> balls, float delta);
+
+private:
+    struct Trajectory {
+        pos2 origin;
+        vec2 velocity;
+        vec2 acceleration;
+        double start;
+        float r;
+        int resting_on; // Surface index, -1 while in flight
+        uint32_t generation;
+    };
+    struct Event {
+        enum class Kind : uint8_t {
+            IMPACT,
+            SLIDE_OFF,
+        };
+        double time;
+        uint32_t ball;
+        uint32_t generation;
+        int surface;
+        Kind kind;
+
+        bool operator>(Event const& other) const { return time > other.time; }
+    };
+
+    [[nodiscard]] ball evaluate(Trajectory const& trajectory, double time) const;
+    void restart(size_t index, ball const& ball, int resting_on);
+    void schedule(size_t index);
+    void handle(Event const& event);
+
+    float m_elasticity;
+    double m_now { 0 };
+    std::vector<surface> m_surfaces;
+    std::vector<Trajectory> m_trajectories;
+    std::vector<ball> m_published; // State written back on the last step
+    size_t m_num_balls { 0 };
+    std::priority_queue<Event, std::vector<Event>, std::greater<>> m_events;
+};
+
+}
+
+#endif // BALLISTIC_HPP
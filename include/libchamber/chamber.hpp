@@ -1,6 +1,8 @@
 #ifndef CHAMBER_HPP
 #define CHAMBER_HPP
 
+#include <algorithm>
+#include <cassert>
 #include <cstddef>
 #ifdef __cplusplus
 extern "C" {
@@ -14,6 +16,8 @@ extern "C" {
 
 namespace chamber {
 
+class SleepTracker;
+
 class Chamber {
 public:
     virtual ~Chamber() = default;
@@ -40,9 +44,82 @@ public:
     virtual void step(size_t num_balls, float delta) = 0;
     virtual void render(size_t canvas_width, size_t canvas_height) = 0;
 
+    // Called by the host with the frame delta. By default this forwards to
+    // step() as is, with a fixed or adaptive step set it splits the delta up
+    // into several calls to step(). The chamber's sleep_tracker(), if any,
+    // is started once per tick as that is when the host writes to the balls.
+    void tick(size_t num_balls, float delta);
+
+    // Simulate in fixed increments of step_len seconds independent of the
+    // frame rate. At most max_substeps are run per tick, time beyond that is
+    // dropped so a slow frame can not snowball. A step_len of 0 restores
+    // pass-through. At least one substep is always allowed, as with none the
+    // simulation would never advance.
+    void set_fixed_step(float step_len, int max_substeps)
+    {
+        assert(step_len >= 0.F);
+        assert(max_substeps >= 1);
+        m_step_mode = step_len > 0.F ? StepMode::FIXED : StepMode::PASS_THROUGH;
+        m_step_len = step_len;
+        m_max_substeps = std::max(max_substeps, 1);
+        reset_schedule();
+    }
+
+    // Split each tick into as few equal substeps as keep the fastest ball from
+    // moving more than max_travel times min_feature_size() per substep, capped
+    // at max_substeps. Calm frames take a single step. Only the balls
+    // sleep_tracker() lists as awake are considered, if the chamber has one.
+    void set_adaptive_step(float max_travel, int max_substeps)
+    {
+        assert(max_travel > 0.F);
+        assert(max_substeps >= 1);
+        m_step_mode = StepMode::ADAPTIVE;
+        m_max_travel = max_travel;
+        m_max_substeps = std::max(max_substeps, 1);
+        reset_schedule();
+    }
+
+    // How far the leftover time is into the next fixed step, in [0, 1). State
+    // owned by the chamber can be drawn interpolated between the last two
+    // steps with it. Always 0 unless a fixed step is set.
+    [[nodiscard]] float interpolation_alpha() const
+    {
+        return m_step_mode == StepMode::FIXED ? m_step_accumulator / m_step_len : 0.F;
+    }
+
 protected:
+    // Smallest distance a ball may cover in one adaptive substep without
+    // skipping past geometry. Chambers with thin or small features should
+    // return those if smaller than the balls.
+    [[nodiscard]] virtual float min_feature_size(float min_ball_radius) const { return min_ball_radius; }
+
+    // Chambers that keep settled balls asleep return their tracker, so the
+    // tick can start it and size adaptive substeps from the awake balls only
+    [[nodiscard]] virtual SleepTracker* sleep_tracker() { return nullptr; }
+
+    // Drops the time carried over towards the next fixed step. The leftover
+    // belongs to the state it was accumulated with, so load() overrides that
+    // restore simulated state should call this, or the first tick after would
+    // replay part of a step and interpolate from a stale phase.
+    void reset_schedule() { m_step_accumulator = 0.F; }
+
     std::vector<ball> m_balls;
     std::vector<uint32_t> m_canvas;
+
+private:
+    enum class StepMode {
+        PASS_THROUGH,
+        FIXED,
+        ADAPTIVE,
+    };
+
+    [[nodiscard]] int adaptive_substeps(size_t num_balls, SleepTracker const* sleep, float delta) const;
+
+    StepMode m_step_mode { StepMode::PASS_THROUGH };
+    float m_step_len { 0 };
+    float m_max_travel { 0 };
+    int m_max_substeps { 0 };
+    float m_step_accumulator { 0 };
 };
 
 extern std::unique_ptr<Chamber> g_chamber;
@@ -0,0 +1,33 @@
+#ifndef PIXEL_RECT_HPP
+#define PIXEL_RECT_HPP
+
+#include <algorithm>
+
+namespace chamber {
+
+// Half open pixel rectangle, [left, right) x [top, bottom)
+struct PixelRect {
+    int left { 0 };
+    int top { 0 };
+    int right { 0 };
+    int bottom { 0 };
+
+    [[nodiscard]] constexpr bool empty() const { return left >= right || top >= bottom; }
+    [[nodiscard]] constexpr bool overlaps(PixelRect const& other) const
+    {
+        return left < other.right && other.left < right && top < other.bottom && other.top < bottom;
+    }
+    [[nodiscard]] constexpr PixelRect united(PixelRect const& other) const
+    {
+        return { std::min(left, other.left), std::min(top, other.top), std::max(right, other.right), std::max(bottom, other.bottom) };
+    }
+    [[nodiscard]] constexpr PixelRect intersected(PixelRect const& other) const
+    {
+        return { std::max(left, other.left), std::max(top, other.top), std::min(right, other.right), std::min(bottom, other.bottom) };
+    }
+    bool operator==(PixelRect const&) const = default;
+};
+
+}
+
+#endif // PIXEL_RECT_HPP
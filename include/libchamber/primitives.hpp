@@ -0,0 +1,36 @@
+#ifndef PRIMITIVES_HPP
+#define PRIMITIVES_HPP
+
+#include "pixel_rect.hpp"
+#include <cstddef>
+#include <cstdint>
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <libphysics/physics.h>
+#ifdef __cplusplus
+}
+#endif
+#include <span>
+
+// Shapes drawn straight onto the canvas. Colors are premultiplied RGBA8
+// packed like the canvas pixels. Opaque colors are stored and translucent
+// ones blended over. Positions are in canvas pixels, with pixel centers at
+// half way. Each primitive is clipped once against clip and the canvas, and
+// after that it touches only the pixels inside.
+namespace chamber {
+
+// Fills the pixels of rect, a row at a time with SIMD stores where available
+void fill_rect(PixelRect rect, uint32_t color, PixelRect clip, std::span<uint32_t> canvas, size_t canvas_width);
+
+// Anti-aliased disc. Each row is filled as a solid span between the edge
+// pixels, which are covered in proportion to their distance from the edge.
+void fill_circle(pos2 center, float radius, uint32_t color, PixelRect clip,
+    std::span<uint32_t> canvas, size_t canvas_width);
+
+// Anti-aliased line a pixel wide, with Xiaolin Wu's algorithm
+void draw_line(pos2 from, pos2 to, uint32_t color, PixelRect clip, std::span<uint32_t> canvas, size_t canvas_width);
+
+}
+
+#endif // PRIMITIVES_HPP
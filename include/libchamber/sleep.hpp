@@ -0,0 +1,91 @@
+#ifndef SLEEP_HPP
+#define SLEEP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <libphysics/physics.h>
+#ifdef __cplusplus
+}
+#endif
+#include <span>
+#include <vector>
+
+namespace chamber {
+
+// Keeps settled balls out of the simulation.
+//
+// A ball that stays within SLEEP_DISTANCE of where it settled for SLEEP_TIME
+// seconds of simulated time, and is held up by a resting contact at the end of
+// it, is put to sleep with its velocity zeroed. Displacement is used rather
+// than the instantaneous velocity, as resolving a resting contact every step
+// keeps bouncing that velocity around while the ball stays put. Time rather
+// than a count of steps, so that short substeps do not shorten the wait, and
+// the contact so that a ball slowing down at the top of a bounce does not stop
+// in mid-air. Sleeping balls that touch each other form an island, and the
+// whole island wakes when an awake ball touches any of its members or when the
+// host writes to one of them.
+//
+// Usage: begin_step() once per tick, before the first step, as that is when
+// the host writes to the balls. Then for each step simulate the balls listed
+// by awake(), call mark_supported() for those resting on something, and call
+// end_step(), which keeps awake() current for the next. Chamber::tick() does
+// the begin_step() for a chamber's sleep_tracker().
+class SleepTracker {
+public:
+    static constexpr float SLEEP_DISTANCE = 0.002F;
+    // Several times as long as a ball stays within SLEEP_DISTANCE around the
+    // apex of a bounce, about 40 ms
+    static constexpr float SLEEP_TIME = 0.25F;
+
+    // Wakes sleeping balls the host modified and collects the awake set
+    void begin_step(std::span<ball const> balls);
+    // The ball is pressed against something holding it up this step, e.g. a
+    // surface below it that a collision was resolved against
+    void mark_supported(size_t index) { m_states[index].supported = true; }
+    // Adds the step's delta to the time balls stayed put, puts settled,
+    // supported balls to sleep and wakes islands that were touched by an awake
+    // ball, updating awake() to match
+    void end_step(std::span<ball> balls, float delta);
+
+    // Indices of the balls to simulate this step
+    [[nodiscard]] std::span<uint32_t const> awake() const { return m_awake; }
+    [[nodiscard]] bool is_sleeping(size_t index) const { return m_states[index].sleeping; }
+
+private:
+    struct State {
+        ball snapshot; // Ball as it was put to sleep
+        pos2 anchor; // Where the ball has been staying
+        float still_time; // Seconds spent within SLEEP_DISTANCE of anchor
+        bool supported; // Since the last end_step()
+        bool sleeping;
+    };
+
+    // Sleeping balls that touch, through each other, and the box around them
+    struct Island {
+        float left;
+        float bottom;
+        float right;
+        float top;
+        uint32_t first; // Members are m_sleeping[first, first + count)
+        uint32_t count;
+    };
+
+    void wake(size_t index);
+    void build_islands(std::span<ball const> balls);
+    [[nodiscard]] uint32_t find_island(uint32_t index);
+
+    std::vector<State> m_states;
+    std::vector<uint32_t> m_awake;
+    std::vector<uint32_t> m_sleeping; // Grouped by island, valid while !m_islands_dirty
+    std::vector<uint32_t> m_island; // Union-find parents, valid while !m_islands_dirty
+    std::vector<Island> m_islands; // Valid while !m_islands_dirty
+    std::vector<uint32_t> m_woken_islands; // Kept to not allocate every step
+    bool m_islands_dirty { true };
+};
+
+}
+
+#endif // SLEEP_HPP
@@ -0,0 +1,116 @@
+#ifndef SPRITE_HPP
+#define SPRITE_HPP
+
+#include "pixel_rect.hpp"
+#include <cstddef>
+#include <cstdint>
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <libphysics/physics.h>
+#ifdef __cplusplus
+}
+#endif
+#include <span>
+#include <vector>
+
+namespace chamber {
+
+enum class SpriteFilter {
+    NEAREST,
+    BILINEAR,
+};
+
+// An image along with successively halved copies of it (a mip chain), so it
+// can be drawn at whatever size the canvas calls for. Shrinking reads from
+// the level closest in size, which neither aliases nor spends time on source
+// pixels that are skipped over.
+//
+// Pixels are premultiplied RGBA8, packed into uint32_t like the canvas.
+class Sprite {
+public:
+    struct Level {
+        int width;
+        int height;
+        std::vector<uint32_t> pixels;
+    };
+
+    Sprite() = default;
+    // Pixels are unpremultiplied, in rows from the top, as the converted
+    // images are
+    Sprite(std::span<uint32_t const> pixels, int width, int height);
+
+    [[nodiscard]] bool empty() const { return m_levels.empty(); }
+    [[nodiscard]] int width() const { return m_levels.front().width; }
+    [[nodiscard]] int height() const { return m_levels.front().height; }
+    [[nodiscard]] std::span<Level const> levels() const { return m_levels; }
+
+    // Smallest level still at least width x height pixels, so that drawing
+    // at that size never shrinks a level to half or less
+    [[nodiscard]] Level const& level_for(float width, float height) const;
+
+private:
+    std::vector<Level> m_levels;
+};
+
+// A sprite that can be drawn turned by any angle, through copies of it that
+// are rotated ahead of time to quantized angles. Each copy is resampled when
+// its angle is first drawn. After that, drawing it is a blit. The angles are
+// close enough together that the sprite's corners land within a pixel of
+// where the exact angle would put them.
+//
+// Copies are made for one size at a time and are dropped once the size
+// changes. Past budget bytes, the copies farthest in angle from the one being
+// drawn are dropped first. A sprite turning steadily keeps its neighbours.
+// The copy being drawn is always kept, even if it alone is over budget.
+class RotatedSprite {
+public:
+    // An eighth of the 512 KB heap the chambers are linked with, which can
+    // not grow and also has to hold the canvas
+    static constexpr size_t DEFAULT_BUDGET = (512U << 10U) / 8;
+
+    RotatedSprite() = default;
+    explicit RotatedSprite(Sprite sprite, size_t budget = DEFAULT_BUDGET);
+
+    [[nodiscard]] Sprite const& sprite() const { return m_sprite; }
+
+    // Takes effect the next time a copy is made
+    void set_budget(size_t budget) { m_budget = budget; }
+
+    // Canvas pixels the copy for angle covers, when drawn centered on center
+    // at width x height before turning
+    [[nodiscard]] PixelRect rect(pos2 center, float width, float height, float angle) const;
+
+    // Composites the sprite over the canvas, scaled to width x height pixels,
+    // turned counterclockwise by angle radians and centered on center. Only
+    // the pixels inside clip are touched.
+    void draw(pos2 center, float width, float height, float angle, PixelRect clip,
+        std::span<uint32_t> canvas, size_t canvas_width);
+
+private:
+    // Drops copies, farthest from step first, until back under budget
+    void evict_around(size_t step);
+
+    Sprite m_sprite;
+    size_t m_budget { DEFAULT_BUDGET };
+    float m_width {};
+    float m_height {};
+    std::vector<Sprite::Level> m_copies; // One per step, empty until drawn
+    size_t m_bytes {};
+};
+
+// Canvas pixels covered by a sprite drawn centered on center at the given
+// size, those whose centers lie inside it
+[[nodiscard]] PixelRect sprite_rect(pos2 center, float width, float height);
+
+// Composites the sprite over the canvas, scaled to width x height pixels and
+// centered on center, touching only the pixels inside clip
+void draw_sprite(Sprite const& sprite, pos2 center, float width, float height, PixelRect clip,
+    SpriteFilter filter, std::span<uint32_t> canvas, size_t canvas_width);
+
+// Composites premultiplied source pixels over as many target pixels
+void blend_over(std::span<uint32_t> target, std::span<uint32_t const> source);
+
+}
+
+#endif // SPRITE_HPP
@@ -0,0 +1,80 @@
+#ifndef VIEWPORT_HPP
+#define VIEWPORT_HPP
+
+#include "pixel_rect.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <libphysics/physics.h>
+#ifdef __cplusplus
+}
+#endif
+#include <span>
+
+namespace chamber {
+
+// Maps the normalized coordinates the physics works in onto canvas pixels.
+// x runs from 0 to 1 across the canvas width and y up from 0 at the bottom
+// edge in the same units, so how far up the canvas reaches depends on its
+// height. Pixel y runs down from the top edge.
+//
+// Built once per canvas size, after which mapping a point is a multiply and
+// an add per axis.
+class Viewport {
+public:
+    constexpr Viewport() = default;
+    constexpr Viewport(size_t canvas_width, size_t canvas_height)
+        : m_width(canvas_width)
+        , m_height(canvas_height)
+        , m_scale(static_cast<float>(canvas_width))
+        , m_bottom(static_cast<float>(canvas_height))
+    {
+    }
+
+    [[nodiscard]] constexpr size_t width() const { return m_width; }
+    [[nodiscard]] constexpr size_t height() const { return m_height; }
+    // Pixels per normalized unit, along either axis
+    [[nodiscard]] constexpr float scale() const { return m_scale; }
+
+    [[nodiscard]] constexpr pos2 to_pixels(pos2 position) const
+    {
+        return { position.x * m_scale, m_bottom - position.y * m_scale };
+    }
+    [[nodiscard]] constexpr pos2 to_normalized(pos2 pixel) const
+    {
+        return { pixel.x / m_scale, (m_bottom - pixel.y) / m_scale };
+    }
+    // Maps positions into pixels.first(positions.size()), which pixels must be
+    // large enough to hold. Positions past the end of a short pixels are left
+    // unmapped rather than written past it.
+    constexpr void to_pixels(std::span<pos2 const> positions, std::span<pos2> pixels) const
+    {
+        assert(pixels.size() >= positions.size());
+        size_t const count = std::min(positions.size(), pixels.size());
+        for (size_t i = 0; i < count; ++i) {
+            pixels[i] = to_pixels(positions[i]);
+        }
+    }
+
+    // The whole canvas, to clip drawing to
+    [[nodiscard]] constexpr PixelRect bounds() const
+    {
+        return { 0, 0, static_cast<int>(m_width), static_cast<int>(m_height) };
+    }
+    [[nodiscard]] constexpr PixelRect clipped(PixelRect rect) const { return rect.intersected(bounds()); }
+
+    bool operator==(Viewport const&) const = default;
+
+private:
+    size_t m_width { 0 };
+    size_t m_height { 0 };
+    float m_scale { 0 };
+    float m_bottom { 0 };
+};
+
+}
+
+#endif // VIEWPORT_HPP
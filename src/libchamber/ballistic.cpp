@@ -0,0 +1,281 @@
+#include "libchamber/ballistic.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace chamber {
+
+namespace {
+
+constexpr float NEVER = std::numeric_limits<float>::infinity();
+// How far past the end of a surface a ball that slides off it is put, so
+// rounding can not leave it still over the surface
+constexpr float SLIDE_OFF_MARGIN = 1e-5F;
+
+struct SurfaceFrame {
+    pos2 origin;
+    vec2 tangent;
+    vec2 normal; // Points up if a is left of b
+    float length;
+};
+
+SurfaceFrame frame_of(surface const& surface)
+{
+    vec2 const span = pos2_sub(&surface.b, &surface.a);
+    float const length = vec2_length(&span);
+    vec2 const tangent = vec2_mul(&span, 1.F / length);
+    return {
+        .origin = surface.a,
+        .tangent = tangent,
+        .normal = { -tangent.y, tangent.x },
+        .length = length,
+    };
+}
+
+// Roots of a*t^2 + b*t + c = 0 in ascending order, NEVER where there is none
+std::array<float, 2> solve_quadratic(float a, float b, float c)
+{
+    static constexpr float EPSILON = 1e-9F;
+    if (std::abs(a) < EPSILON) {
+        if (std::abs(b) < EPSILON) {
+            return { NEVER, NEVER };
+        }
+        return { -c / b, NEVER };
+    }
+    float const discriminant = b * b - 4.F * a * c;
+    if (discriminant < 0.F) {
+        return { NEVER, NEVER };
+    }
+    // Numerically stable form, avoids cancellation between -b and the root
+    float const q = -0.5F * (b + std::copysign(std::sqrt(discriminant), b));
+    float t1 = q / a;
+    float t2 = q != 0.F ? c / q : t1;
+    if (t1 > t2) {
+        std::swap(t1, t2);
+    }
+    return { t1, t2 };
+}
+
+// Time until the ball's edge touches the surface from either side, NEVER if it
+// does not while moving towards it within the surface's extent
+float time_of_impact(SurfaceFrame const& frame, pos2 origin, vec2 velocity, vec2 acceleration, float r)
+{
+    vec2 const relative = pos2_sub(&origin, &frame.origin);
+    float const d0 = vec2_dot(&relative, &frame.normal);
+    float const dv = vec2_dot(&velocity, &frame.normal);
+    float const da = vec2_dot(&acceleration, &frame.normal);
+    float const t0 = vec2_dot(&relative, &frame.tangent);
+    float const tv = vec2_dot(&velocity, &frame.tangent);
+    float const ta = vec2_dot(&acceleration, &frame.tangent);
+
+    bool const within = t0 >= 0.F && t0 <= frame.length;
+    // Already overlapping, e.g. after the host placed the ball, resolve now
+    // only if it is moving further in. One at rest relative to the surface
+    // would otherwise be resolved again and again at the same time.
+    bool const approaching = dv != 0.F ? dv * d0 < 0.F : da * d0 < 0.F;
+    if (within && std::abs(d0) < r && approaching) {
+        return 0.F;
+    }
+
+    float earliest = NEVER;
+    for (float const side : { 1.F, -1.F }) {
+        for (float const t : solve_quadratic(0.5F * da, dv, d0 - side * r)) {
+            if (t < 0.F || t >= earliest) {
+                continue;
+            }
+            // Has to be approaching the surface from this side
+            if ((dv + da * t) * side >= 0.F) {
+                continue;
+            }
+            float const along = t0 + tv * t + 0.5F * ta * t * t;
+            if (along >= 0.F && along <= frame.length) {
+                earliest = t;
+            }
+        }
+    }
+    return earliest;
+}
+
+// Time until a ball sliding along the surface passes one of its ends
+float time_to_slide_off(SurfaceFrame const& frame, pos2 origin, vec2 velocity, vec2 acceleration)
+{
+    vec2 const relative = pos2_sub(&origin, &frame.origin);
+    float const t0 = vec2_dot(&relative, &frame.tangent);
+    float const tv = vec2_dot(&velocity, &frame.tangent);
+    float const ta = vec2_dot(&acceleration, &frame.tangent);
+
+    float earliest = NEVER;
+    for (float const end : { 0.F, frame.length }) {
+        for (float const t : solve_quadratic(0.5F * ta, tv, t0 - end)) {
+            if (t > 0.F && t < earliest) {
+                earliest = t;
+            }
+        }
+    }
+    return earliest;
+}
+
+}
+
+ball BallisticEngine::evaluate(Trajectory const& trajectory, double time) const
+{
+    auto const t = static_cast<float>(time - trajectory.start);
+    return {
+        .pos = {
+            trajectory.origin.x + trajectory.velocity.x * t + 0.5F * trajectory.acceleration.x * t * t,
+            trajectory.origin.y + trajectory.velocity.y * t + 0.5F * trajectory.acceleration.y * t * t,
+        },
+        .r = trajectory.r,
+        .velocity = {
+            trajectory.velocity.x + trajectory.acceleration.x * t,
+            trajectory.velocity.y + trajectory.acceleration.y * t,
+        },
+    };
+}
+
+void BallisticEngine::restart(size_t index, ball const& ball, int resting_on)
+{
+    auto& trajectory = m_trajectories[index];
+    trajectory.origin = ball.pos;
+    trajectory.velocity = ball.velocity;
+    trajectory.acceleration = { 0, GRAVITY };
+    trajectory.start = m_now;
+    trajectory.r = ball.r;
+    trajectory.resting_on = resting_on;
+    // Any event already queued for this ball is now stale
+    trajectory.generation++;
+
+    if (resting_on >= 0) {
+        // Only the component of gravity along the surface moves a resting ball
+        auto const frame = frame_of(m_surfaces[resting_on]);
+        float const along = vec2_dot(&trajectory.acceleration, &frame.tangent);
+        trajectory.acceleration = vec2_mul(&frame.tangent, along);
+    }
+    schedule(index);
+}
+
+void BallisticEngine::schedule(size_t index)
+{
+    auto const& trajectory = m_trajectories[index];
+    Event next {
+        .time = std::numeric_limits<double>::infinity(),
+        .ball = static_cast<uint32_t>(index),
+        .generation = trajectory.generation,
+        .surface = -1,
+        .kind = Event::Kind::IMPACT,
+    };
+
+    for (size_t i = 0; i < m_surfaces.size(); ++i) {
+        auto const frame = frame_of(m_surfaces[i]);
+        float t = NEVER;
+        Event::Kind kind = Event::Kind::IMPACT;
+        if (static_cast<int>(i) == trajectory.resting_on) {
+            t = time_to_slide_off(frame, trajectory.origin, trajectory.velocity, trajectory.acceleration);
+            kind = Event::Kind::SLIDE_OFF;
+        } else {
+            t = time_of_impact(frame, trajectory.origin, trajectory.velocity, trajectory.acceleration, trajectory.r);
+        }
+        if (t != NEVER && trajectory.start + t < next.time) {
+            next.time = trajectory.start + t;
+            next.surface = static_cast<int>(i);
+            next.kind = kind;
+        }
+    }
+
+    if (next.surface >= 0) {
+        m_events.push(next);
+    }
+}
+
+void BallisticEngine::handle(Event const& event)
+{
+    auto const& trajectory = m_trajectories[event.ball];
+    ball state = evaluate(trajectory, event.time);
+    double const now = m_now;
+    m_now = event.time;
+
+    auto const frame = frame_of(m_surfaces[event.surface]);
+    vec2 const relative = pos2_sub(&state.pos, &frame.origin);
+
+    if (event.kind == Event::Kind::SLIDE_OFF) {
+        // Rounding can leave the ball short of the end it slides off, still
+        // over the surface, where it would land right back on it with no end
+        // left to slide off. Put it just past the end instead.
+        float const along = vec2_dot(&relative, &frame.tangent);
+        float const past = along < 0.5F * frame.length ? std::min(along, -SLIDE_OFF_MARGIN)
+                                                       : std::max(along, frame.length + SLIDE_OFF_MARGIN);
+        vec2 const nudge = vec2_mul(&frame.tangent, past - along);
+        state.pos = pos2_add(&state.pos, &nudge);
+        restart(event.ball, state, -1);
+        m_now = now;
+        return;
+    }
+
+    float const distance = vec2_dot(&relative, &frame.normal);
+    float const side = distance >= 0.F ? 1.F : -1.F;
+    // Push an overlapping ball out to touch the surface, so the restarted
+    // flight does not begin inside it
+    if (std::abs(distance) < state.r) {
+        vec2 const push = vec2_mul(&frame.normal, side * state.r - distance);
+        state.pos = pos2_add(&state.pos, &push);
+    }
+    float const normal_speed = vec2_dot(&state.velocity, &frame.normal);
+    float const bounce_speed = -normal_speed * m_elasticity;
+
+    // A ball can only come to rest where gravity presses it onto the surface
+    bool const pressed = frame.normal.y * side > 0.F;
+    if (pressed && std::abs(bounce_speed) < REST_SPEED) {
+        vec2 const removed = vec2_mul(&frame.normal, normal_speed);
+        state.velocity = vec2_sub(&state.velocity, &removed);
+        restart(event.ball, state, event.surface);
+    } else if (normal_speed * side >= 0.F) {
+        // Touching without moving into it, nothing to bounce off
+        restart(event.ball, state, -1);
+    } else {
+        vec2 const change = vec2_mul(&frame.normal, bounce_speed - normal_speed);
+        state.velocity = vec2_add(&state.velocity, &change);
+        restart(event.ball, state, -1);
+    }
+    m_now = now;
+}
+
+void BallisticEngine::step(std::span<ball> balls, float delta)
+{
+    if (balls.size() > m_trajectories.size()) {
+        m_trajectories.resize(balls.size(), Trajectory {});
+        m_published.resize(balls.size(), ball {});
+    }
+
+    // Anything the host wrote since the last step restarts from its new state
+    for (size_t i = 0; i < balls.size(); ++i) {
+        if (i >= m_num_balls || std::memcmp(&balls[i], &m_published[i], sizeof(ball)) != 0) {
+            restart(i, balls[i], -1);
+        }
+    }
+    // Retire events of balls that are gone
+    for (size_t i = balls.size(); i < m_num_balls; ++i) {
+        m_trajectories[i].generation++;
+    }
+    m_num_balls = balls.size();
+
+    double const end = m_now + static_cast<double>(delta);
+    while (!m_events.empty() && m_events.top().time <= end) {
+        Event const event = m_events.top();
+        m_events.pop();
+        if (event.ball >= m_num_balls || event.generation != m_trajectories[event.ball].generation) {
+            continue;
+        }
+        handle(event);
+    }
+    m_now = end;
+
+    for (size_t i = 0; i < balls.size(); ++i) {
+        balls[i] = evaluate(m_trajectories[i], m_now);
+        m_published[i] = balls[i];
+    }
+}
+
+}
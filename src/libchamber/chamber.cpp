@@ -1,8 +1,80 @@
 #include "libchamber/chamber.hpp"
+#include "libchamber/sleep.hpp"
 #include "exports.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <span>
 
 namespace chamber {
 std::unique_ptr<Chamber> g_chamber = nullptr;
+
+int Chamber::adaptive_substeps(size_t num_balls, SleepTracker const* sleep, float delta) const
+{
+    // A plain loop, the balls are stored whole so the speeds and radii would
+    // have to be gathered a lane at a time before any SIMD could use them
+    float max_speed_2 = 0.F;
+    float min_radius = std::numeric_limits<float>::max();
+    auto const measure = [&](ball const& ball) {
+        max_speed_2 = std::max(max_speed_2, ball.velocity.x * ball.velocity.x + ball.velocity.y * ball.velocity.y);
+        min_radius = std::min(min_radius, ball.r);
+    };
+    if (sleep != nullptr) {
+        for (auto const i : sleep->awake()) {
+            measure(m_balls[i]);
+        }
+    } else {
+        for (auto const& ball : std::span(m_balls).first(num_balls)) {
+            measure(ball);
+        }
+    }
+    if (max_speed_2 == 0.F) {
+        return 1;
+    }
+
+    float const max_travel = std::sqrt(max_speed_2) * delta;
+    float const allowed_travel = m_max_travel * min_feature_size(min_radius);
+    if (!(allowed_travel > 0.F)) {
+        return m_max_substeps;
+    }
+    float const substeps = std::ceil(max_travel / allowed_travel);
+    if (!(substeps < static_cast<float>(m_max_substeps))) {
+        return m_max_substeps;
+    }
+    return std::max(static_cast<int>(substeps), 1);
+}
+
+void Chamber::tick(size_t num_balls, float delta)
+{
+    SleepTracker* const sleep = sleep_tracker();
+    if (sleep != nullptr) {
+        sleep->begin_step(std::span(m_balls).first(num_balls));
+    }
+
+    if (m_step_mode == StepMode::PASS_THROUGH) {
+        step(num_balls, delta);
+        return;
+    }
+    if (m_step_mode == StepMode::ADAPTIVE) {
+        int const substeps = adaptive_substeps(num_balls, sleep, delta);
+        float const substep_len = delta / static_cast<float>(substeps);
+        for (int i = 0; i < substeps; ++i) {
+            step(num_balls, substep_len);
+        }
+        return;
+    }
+
+    m_step_accumulator += delta;
+    int substeps = 0;
+    while (m_step_accumulator >= m_step_len && substeps < m_max_substeps) {
+        step(num_balls, m_step_len);
+        m_step_accumulator -= m_step_len;
+        ++substeps;
+    }
+    if (m_step_accumulator >= m_step_len) {
+        m_step_accumulator = std::fmod(m_step_accumulator, m_step_len);
+    }
+}
 }
 
 void* ballsMemory(void) { return chamber::g_chamber->balls_memory(); }
@@ -11,5 +83,5 @@ void* saveMemory(void) { return chamber::g_chamber->save_memory(); }
 size_t saveSize(void) { return chamber::g_chamber->save_size(); }
 void save(void) { chamber::g_chamber->save(); }
 void load(void) { chamber::g_chamber->load(); }
-void step(size_t num_balls, float delta) { chamber::g_chamber->step(num_balls, delta); }
+void step(size_t num_balls, float delta) { chamber::g_chamber->tick(num_balls, delta); }
 void render(size_t canvas_width, size_t canvas_height) { chamber::g_chamber->render(canvas_width, canvas_height); }
@@ -0,0 +1,47 @@
+#ifndef PIXEL_HPP
+#define PIXEL_HPP
+
+#include <cstdint>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define CHAMBER_SSE2
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define CHAMBER_SIMD128
+#endif
+
+// Arithmetic on premultiplied RGBA8 pixels packed into uint32_t, shared by
+// the drawing code
+namespace chamber {
+
+// Red and blue, or shifted down by a byte green and alpha, each with a byte
+// of headroom so two channels can be worked on at once
+inline constexpr uint32_t LOW_CHANNELS = 0x00FF00FFU;
+inline constexpr uint32_t HIGH_CHANNELS = 0xFF00FF00U;
+
+// Scales all four channels of a pixel by factor / 255. The rounding is exact
+// for every 8 bit product.
+inline uint32_t scale_pixel(uint32_t pixel, uint32_t factor)
+{
+    uint32_t red_blue = (pixel & LOW_CHANNELS) * factor + 0x00800080U;
+    uint32_t green_alpha = ((pixel >> 8U) & LOW_CHANNELS) * factor + 0x00800080U;
+    red_blue = ((red_blue + ((red_blue >> 8U) & LOW_CHANNELS)) >> 8U) & LOW_CHANNELS;
+    green_alpha = (green_alpha + ((green_alpha >> 8U) & LOW_CHANNELS)) & HIGH_CHANNELS;
+    return red_blue | green_alpha;
+}
+
+inline uint32_t blend_pixel(uint32_t target, uint32_t source)
+{
+    uint32_t const alpha = source >> 24U;
+    if (alpha == 0) {
+        return target;
+    }
+    if (alpha == 255) {
+        return source;
+    }
+    return source + scale_pixel(target, 255 - alpha);
+}
+
+}
+
+#endif // PIXEL_HPP
@@ -0,0 +1,204 @@
+#include "libchamber/primitives.hpp"
+#include "pixel.hpp"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace chamber {
+
+namespace {
+
+PixelRect canvas_bounds(std::span<uint32_t> canvas, size_t canvas_width)
+{
+    return { 0, 0, static_cast<int>(canvas_width), static_cast<int>(canvas.size() / canvas_width) };
+}
+
+// Opaque colors are stored four pixels at a time where SIMD is available,
+// translucent ones are blended over each pixel
+void fill_row(std::span<uint32_t> row, uint32_t color)
+{
+    if (color >> 24U != 255) {
+        for (auto& pixel : row) {
+            pixel = blend_pixel(pixel, color);
+        }
+        return;
+    }
+    size_t i = 0;
+#if defined(CHAMBER_SSE2)
+    __m128i const colors = _mm_set1_epi32(static_cast<int>(color));
+    for (; i + 4 <= row.size(); i += 4) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&row[i]), colors);
+    }
+#elif defined(CHAMBER_SIMD128)
+    v128_t const colors = wasm_u32x4_splat(color);
+    for (; i + 4 <= row.size(); i += 4) {
+        wasm_v128_store(&row[i], colors);
+    }
+#endif
+    for (; i < row.size(); ++i) {
+        row[i] = color;
+    }
+}
+
+// Blends color over the pixel, covering coverage / 255 of it
+void plot(uint32_t& pixel, uint32_t color, uint32_t coverage)
+{
+    pixel = blend_pixel(pixel, scale_pixel(color, coverage));
+}
+
+uint32_t to_coverage(float fraction)
+{
+    return static_cast<uint32_t>(std::clamp(fraction, 0.F, 1.F) * 255.F + 0.5F);
+}
+
+// The pixels whose centers lie in [from, to), as [first, last)
+std::pair<int, int> pixel_span(float from, float to)
+{
+    return { static_cast<int>(std::ceil(from - 0.5F)), static_cast<int>(std::ceil(to - 0.5F)) };
+}
+
+}
+
+void fill_rect(PixelRect rect, uint32_t color, PixelRect clip, std::span<uint32_t> canvas, size_t canvas_width)
+{
+    if (canvas_width == 0) {
+        return;
+    }
+    PixelRect const visible = rect.intersected(clip).intersected(canvas_bounds(canvas, canvas_width));
+    if (visible.empty()) {
+        return;
+    }
+    auto const count = static_cast<size_t>(visible.right - visible.left);
+    for (int y = visible.top; y < visible.bottom; ++y) {
+        fill_row(canvas.subspan(static_cast<size_t>(y) * canvas_width + static_cast<size_t>(visible.left), count), color);
+    }
+}
+
+// A pixel is covered by radius + 0.5 less its distance from the center, up to
+// all of it. Each row is split where that distance crosses radius - 0.5 and
+// radius + 0.5: the pixels between the inner points are all covered and are
+// filled as one span, leaving only the pixels out to the outer points to be
+// worked out one by one.
+void fill_circle(pos2 center, float radius, uint32_t color, PixelRect clip,
+    std::span<uint32_t> canvas, size_t canvas_width)
+{
+    if (canvas_width == 0 || !(radius > 0.F)) {
+        return;
+    }
+    float const outer = radius + 0.5F;
+    float const inner = radius - 0.5F;
+    auto const [left, right] = pixel_span(center.x - outer, center.x + outer);
+    auto const [top, bottom] = pixel_span(center.y - outer, center.y + outer);
+    PixelRect const visible = PixelRect { left, top, right, bottom }.intersected(clip).intersected(canvas_bounds(canvas, canvas_width));
+    if (visible.empty()) {
+        return;
+    }
+
+    for (int y = visible.top; y < visible.bottom; ++y) {
+        float const offset_y = static_cast<float>(y) + 0.5F - center.y;
+        float const outer_half = std::sqrt(std::max(outer * outer - offset_y * offset_y, 0.F));
+        auto [edge_left, edge_right] = pixel_span(center.x - outer_half, center.x + outer_half);
+        edge_left = std::max(edge_left, visible.left);
+        edge_right = std::min(edge_right, visible.right);
+        int solid_left = edge_right;
+        int solid_right = edge_right;
+        if (inner > std::abs(offset_y)) {
+            float const inner_half = std::sqrt(inner * inner - offset_y * offset_y);
+            auto const [from, to] = pixel_span(center.x - inner_half, center.x + inner_half);
+            solid_left = std::clamp(from, edge_left, edge_right);
+            solid_right = std::clamp(to, solid_left, edge_right);
+        }
+
+        uint32_t* row = canvas.data() + static_cast<size_t>(y) * canvas_width;
+        auto const fringe = [&](int from, int to) {
+            for (int x = from; x < to; ++x) {
+                float const offset_x = static_cast<float>(x) + 0.5F - center.x;
+                float const coverage = outer - std::sqrt(offset_x * offset_x + offset_y * offset_y);
+                if (coverage > 0.F) {
+                    plot(row[x], color, to_coverage(coverage));
+                }
+            }
+        };
+        fringe(edge_left, solid_left);
+        fill_row(std::span(row + solid_left, row + solid_right), color);
+        fringe(solid_right, edge_right);
+    }
+}
+
+// Walks the major axis a pixel at a time, sharing each step between the two
+// pixels across the minor axis the line passes between, in proportion to how
+// close it passes to each. The minor position is stepped in 16.16 fixed point,
+// its top byte of fraction being the share. The ends are faded by how much of
+// their pixel the line reaches into. The walk is clipped to the columns (or
+// rows) of clip once, leaving only the two pixels of each step to test
+// against the other axis.
+void draw_line(pos2 from, pos2 to, uint32_t color, PixelRect clip, std::span<uint32_t> canvas, size_t canvas_width)
+{
+    if (canvas_width == 0) {
+        return;
+    }
+    PixelRect const visible = clip.intersected(canvas_bounds(canvas, canvas_width));
+    if (visible.empty()) {
+        return;
+    }
+
+    // With pixel centers on whole coordinates, as the algorithm has them
+    float x0 = from.x - 0.5F;
+    float y0 = from.y - 0.5F;
+    float x1 = to.x - 0.5F;
+    float y1 = to.y - 0.5F;
+    bool const steep = std::abs(y1 - y0) > std::abs(x1 - x0);
+    if (steep) {
+        std::swap(x0, y0);
+        std::swap(x1, y1);
+    }
+    if (x0 > x1) {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+    }
+    int const major_first = steep ? visible.top : visible.left;
+    int const major_last = steep ? visible.bottom : visible.right;
+    int const minor_first = steep ? visible.left : visible.top;
+    int const minor_last = steep ? visible.right : visible.bottom;
+    float const gradient = x1 > x0 ? (y1 - y0) / (x1 - x0) : 0.F;
+
+    auto const put = [&](int major, int minor, uint32_t coverage) {
+        if (minor >= minor_first && minor < minor_last) {
+            auto const index = steep ? static_cast<size_t>(major) * canvas_width + static_cast<size_t>(minor)
+                                     : static_cast<size_t>(minor) * canvas_width + static_cast<size_t>(major);
+            plot(canvas[index], color, coverage);
+        }
+    };
+    auto const step = [&](int major, int32_t minor) {
+        auto const share = static_cast<uint32_t>(minor >> 8) & 0xFFU;
+        put(major, minor >> 16, 255 - share);
+        put(major, (minor >> 16) + 1, share);
+    };
+    auto const end = [&](int major, float coverage) {
+        if (major >= major_first && major < major_last) {
+            float const minor = y0 + gradient * (static_cast<float>(major) - x0);
+            float const below = std::floor(minor);
+            put(major, static_cast<int>(below), to_coverage((1.F - (minor - below)) * coverage));
+            put(major, static_cast<int>(below) + 1, to_coverage((minor - below) * coverage));
+        }
+    };
+
+    auto const first = static_cast<int>(std::round(x0));
+    auto const last = static_cast<int>(std::round(x1));
+    if (first == last) {
+        end(first, x1 - x0);
+        return;
+    }
+    end(first, 1.F - (x0 + 0.5F - std::floor(x0 + 0.5F)));
+    end(last, x1 + 0.5F - std::floor(x1 + 0.5F));
+
+    int const begin = std::max(first + 1, major_first);
+    int const stop = std::min(last, major_last);
+    auto const minor_step = static_cast<int32_t>(std::lround(gradient * 65536.F));
+    auto minor = static_cast<int32_t>(std::lround((y0 + gradient * (static_cast<float>(begin) - x0)) * 65536.F));
+    for (int major = begin; major < stop; ++major, minor += minor_step) {
+        step(major, minor);
+    }
+}
+
+}
@@ -0,0 +1,184 @@
+#include "libchamber/sleep.hpp"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace chamber {
+
+namespace {
+
+bool touching(ball const& a, ball const& b)
+{
+    vec2 const between = pos2_sub(&a.pos, &b.pos);
+    float const reach = a.r + b.r;
+    return vec2_length_2(&between) <= reach * reach;
+}
+
+}
+
+void SleepTracker::begin_step(std::span<ball const> balls)
+{
+    if (balls.size() > m_states.size()) {
+        m_states.resize(balls.size(), State {});
+    }
+
+    m_awake.clear();
+    for (size_t i = 0; i < balls.size(); ++i) {
+        auto& state = m_states[i];
+        if (state.sleeping && std::memcmp(&balls[i], &state.snapshot, sizeof(ball)) != 0) {
+            wake(i);
+        }
+        if (!state.sleeping) {
+            m_awake.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    // Slots past the end are reused for new balls later, which start awake
+    for (size_t i = balls.size(); i < m_states.size(); ++i) {
+        if (m_states[i].sleeping) {
+            wake(i);
+        }
+    }
+}
+
+void SleepTracker::end_step(std::span<ball> balls, float delta)
+{
+    bool fell_asleep = false;
+    for (auto const i : m_awake) {
+        auto& state = m_states[i];
+        auto& ball = balls[i];
+        bool const supported = std::exchange(state.supported, false);
+        vec2 const drift = pos2_sub(&ball.pos, &state.anchor);
+        if (vec2_length_2(&drift) > SLEEP_DISTANCE * SLEEP_DISTANCE) {
+            state.anchor = ball.pos;
+            state.still_time = 0.F;
+            continue;
+        }
+        state.still_time += delta;
+        if (state.still_time < SLEEP_TIME || !supported) {
+            continue;
+        }
+        ball.velocity = { 0, 0 };
+        state.snapshot = ball;
+        state.sleeping = true;
+        m_islands_dirty = true;
+        fell_asleep = true;
+    }
+    if (fell_asleep) {
+        std::erase_if(m_awake, [&](uint32_t i) { return m_states[i].sleeping; });
+    }
+
+    if (m_islands_dirty) {
+        build_islands(balls);
+    }
+    if (m_islands.empty()) {
+        return;
+    }
+
+    // Only balls that left their anchor this step disturb an island, ones that
+    // are settling next to it would otherwise keep waking each other up. An
+    // island's members are only checked when the ball reaches its bounds.
+    m_woken_islands.clear();
+    for (auto const i : m_awake) {
+        auto const& ball = balls[i];
+        if (m_states[i].still_time > 0.F) {
+            continue;
+        }
+        for (size_t k = 0; k < m_islands.size(); ++k) {
+            auto const& island = m_islands[k];
+            if (ball.pos.x + ball.r < island.left || ball.pos.x - ball.r > island.right
+                || ball.pos.y + ball.r < island.bottom || ball.pos.y - ball.r > island.top) {
+                continue;
+            }
+            auto const members = std::span(m_sleeping).subspan(island.first, island.count);
+            if (std::ranges::any_of(members, [&](uint32_t j) { return touching(ball, balls[j]); })) {
+                m_woken_islands.push_back(static_cast<uint32_t>(k));
+            }
+        }
+    }
+    if (m_woken_islands.empty()) {
+        return;
+    }
+
+    std::ranges::sort(m_woken_islands);
+    auto const [last, end] = std::ranges::unique(m_woken_islands);
+    m_woken_islands.erase(last, end);
+    for (auto const k : m_woken_islands) {
+        auto const& island = m_islands[k];
+        for (auto const j : std::span(m_sleeping).subspan(island.first, island.count)) {
+            wake(j);
+            m_awake.push_back(j);
+        }
+    }
+}
+
+void SleepTracker::wake(size_t index)
+{
+    m_states[index].sleeping = false;
+    m_states[index].still_time = 0.F;
+    m_states[index].supported = false;
+    m_islands_dirty = true;
+}
+
+// Quadratic in the number of sleeping balls, but only rebuilt when the sleeping
+// set changes. The sleeping balls are then grouped by island, so each island
+// is a range of m_sleeping with the bounds of its members.
+void SleepTracker::build_islands(std::span<ball const> balls)
+{
+    m_sleeping.clear();
+    for (size_t i = 0; i < balls.size(); ++i) {
+        if (m_states[i].sleeping) {
+            m_sleeping.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    m_island.resize(m_states.size());
+    for (auto const i : m_sleeping) {
+        m_island[i] = i;
+    }
+    for (size_t a = 0; a < m_sleeping.size(); ++a) {
+        for (size_t b = a + 1; b < m_sleeping.size(); ++b) {
+            if (touching(balls[m_sleeping[a]], balls[m_sleeping[b]])) {
+                m_island[find_island(m_sleeping[a])] = find_island(m_sleeping[b]);
+            }
+        }
+    }
+    // Point every ball straight at its root to group by it
+    for (auto const i : m_sleeping) {
+        m_island[i] = find_island(i);
+    }
+    std::ranges::sort(m_sleeping, {}, [&](uint32_t i) { return m_island[i]; });
+
+    m_islands.clear();
+    for (size_t a = 0; a < m_sleeping.size(); ++a) {
+        auto const& ball = balls[m_sleeping[a]];
+        if (a == 0 || m_island[m_sleeping[a]] != m_island[m_sleeping[a - 1]]) {
+            m_islands.push_back({
+                .left = ball.pos.x - ball.r,
+                .bottom = ball.pos.y - ball.r,
+                .right = ball.pos.x + ball.r,
+                .top = ball.pos.y + ball.r,
+                .first = static_cast<uint32_t>(a),
+                .count = 0,
+            });
+        }
+        auto& island = m_islands.back();
+        island.left = std::min(island.left, ball.pos.x - ball.r);
+        island.bottom = std::min(island.bottom, ball.pos.y - ball.r);
+        island.right = std::max(island.right, ball.pos.x + ball.r);
+        island.top = std::max(island.top, ball.pos.y + ball.r);
+        ++island.count;
+    }
+    m_islands_dirty = false;
+}
+
+uint32_t SleepTracker::find_island(uint32_t index)
+{
+    while (m_island[index] != index) {
+        // Path halving
+        m_island[index] = m_island[m_island[index]];
+        index = m_island[index];
+    }
+    return index;
+}
+
+}
@@ -0,0 +1,499 @@
+#include "libchamber/sprite.hpp"
+#include "pixel.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numbers>
+#include <utility>
+
+namespace chamber {
+
+namespace {
+
+// Mix of two pixels, weight / 256 of the way from a to b
+uint32_t lerp_pixel(uint32_t a, uint32_t b, uint32_t weight)
+{
+    uint32_t const keep = 256 - weight;
+    uint32_t const red_blue = (((a & LOW_CHANNELS) * keep + (b & LOW_CHANNELS) * weight) >> 8U) & LOW_CHANNELS;
+    uint32_t const green_alpha = (((a >> 8U) & LOW_CHANNELS) * keep + ((b >> 8U) & LOW_CHANNELS) * weight) & HIGH_CHANNELS;
+    return red_blue | green_alpha;
+}
+
+uint32_t average_pixels(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+    uint32_t const red_blue = (a & LOW_CHANNELS) + (b & LOW_CHANNELS) + (c & LOW_CHANNELS) + (d & LOW_CHANNELS) + 0x00020002U;
+    uint32_t const green_alpha = ((a >> 8U) & LOW_CHANNELS) + ((b >> 8U) & LOW_CHANNELS) + ((c >> 8U) & LOW_CHANNELS)
+        + ((d >> 8U) & LOW_CHANNELS) + 0x00020002U;
+    return ((red_blue >> 2U) & LOW_CHANNELS) | (((green_alpha >> 2U) & LOW_CHANNELS) << 8U);
+}
+
+// Box filtered to half the size, rounding up. An odd last row or column is
+// averaged with itself.
+Sprite::Level halved(Sprite::Level const& level)
+{
+    Sprite::Level half { (level.width + 1) / 2, (level.height + 1) / 2, {} };
+    half.pixels.reserve(static_cast<size_t>(half.width) * static_cast<size_t>(half.height));
+    for (int y = 0; y < half.height; ++y) {
+        uint32_t const* upper = &level.pixels[static_cast<size_t>(2 * y) * static_cast<size_t>(level.width)];
+        uint32_t const* lower = &level.pixels[static_cast<size_t>(std::min(2 * y + 1, level.height - 1)) * static_cast<size_t>(level.width)];
+        for (int x = 0; x < half.width; ++x) {
+            int const left = 2 * x;
+            int const right = std::min(left + 1, level.width - 1);
+            half.pixels.push_back(average_pixels(upper[left], upper[right], lower[left], lower[right]));
+        }
+    }
+    return half;
+}
+
+int32_t to_fixed(float value)
+{
+    return static_cast<int32_t>(std::lround(value * 65536.F));
+}
+
+// Bilinear filtering of count pixels between two source rows, each between
+// the columns from and to, weighted across horizontally and down vertically
+// (out of 256). Four pixels at a time where SIMD is available, with each
+// channel widened to 16 bits. The results are the same as lerp_pixel().
+void filter_rows(std::span<uint32_t> out, uint32_t const* upper, uint32_t const* lower,
+    int const* from, int const* to, uint32_t const* across, uint32_t down)
+{
+    size_t i = 0;
+#if defined(CHAMBER_SSE2)
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const whole = _mm_set1_epi16(256);
+    __m128i const vertical = _mm_set1_epi16(static_cast<int16_t>(down));
+    __m128i const vertical_keep = _mm_sub_epi16(whole, vertical);
+    auto const lerp = [](__m128i a, __m128i b, __m128i weight, __m128i keep) {
+        return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(a, keep), _mm_mullo_epi16(b, weight)), 8);
+    };
+    auto const gather = [&](uint32_t const* pixels, int const* columns) {
+        return _mm_setr_epi32(static_cast<int>(pixels[columns[i]]), static_cast<int>(pixels[columns[i + 1]]),
+            static_cast<int>(pixels[columns[i + 2]]), static_cast<int>(pixels[columns[i + 3]]));
+    };
+    for (; i + 4 <= out.size(); i += 4) {
+        __m128i const top_left = gather(upper, from);
+        __m128i const top_right = gather(upper, to);
+        __m128i const bottom_left = gather(lower, from);
+        __m128i const bottom_right = gather(lower, to);
+        __m128i weights = _mm_loadu_si128(reinterpret_cast<__m128i const*>(&across[i]));
+        weights = _mm_or_si128(weights, _mm_slli_epi32(weights, 16));
+        __m128i const weights_low = _mm_unpacklo_epi32(weights, weights);
+        __m128i const weights_high = _mm_unpackhi_epi32(weights, weights);
+        __m128i const keep_low = _mm_sub_epi16(whole, weights_low);
+        __m128i const keep_high = _mm_sub_epi16(whole, weights_high);
+        __m128i const low = lerp(
+            lerp(_mm_unpacklo_epi8(top_left, zero), _mm_unpacklo_epi8(top_right, zero), weights_low, keep_low),
+            lerp(_mm_unpacklo_epi8(bottom_left, zero), _mm_unpacklo_epi8(bottom_right, zero), weights_low, keep_low),
+            vertical, vertical_keep);
+        __m128i const high = lerp(
+            lerp(_mm_unpackhi_epi8(top_left, zero), _mm_unpackhi_epi8(top_right, zero), weights_high, keep_high),
+            lerp(_mm_unpackhi_epi8(bottom_left, zero), _mm_unpackhi_epi8(bottom_right, zero), weights_high, keep_high),
+            vertical, vertical_keep);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&out[i]), _mm_packus_epi16(low, high));
+    }
+#elif defined(CHAMBER_SIMD128)
+    v128_t const whole = wasm_i16x8_splat(256);
+    v128_t const vertical = wasm_i16x8_splat(static_cast<int16_t>(down));
+    v128_t const vertical_keep = wasm_i16x8_sub(whole, vertical);
+    auto const lerp = [](v128_t a, v128_t b, v128_t weight, v128_t keep) {
+        return wasm_u16x8_shr(wasm_i16x8_add(wasm_i16x8_mul(a, keep), wasm_i16x8_mul(b, weight)), 8);
+    };
+    auto const gather = [&](uint32_t const* pixels, int const* columns) {
+        return wasm_u32x4_make(pixels[columns[i]], pixels[columns[i + 1]], pixels[columns[i + 2]], pixels[columns[i + 3]]);
+    };
+    for (; i + 4 <= out.size(); i += 4) {
+        v128_t const top_left = gather(upper, from);
+        v128_t const top_right = gather(upper, to);
+        v128_t const bottom_left = gather(lower, from);
+        v128_t const bottom_right = gather(lower, to);
+        v128_t weights = wasm_v128_load(&across[i]);
+        weights = wasm_v128_or(weights, wasm_i32x4_shl(weights, 16));
+        v128_t const weights_low = wasm_i32x4_shuffle(weights, weights, 0, 0, 1, 1);
+        v128_t const weights_high = wasm_i32x4_shuffle(weights, weights, 2, 2, 3, 3);
+        v128_t const keep_low = wasm_i16x8_sub(whole, weights_low);
+        v128_t const keep_high = wasm_i16x8_sub(whole, weights_high);
+        v128_t const low = lerp(
+            lerp(wasm_u16x8_extend_low_u8x16(top_left), wasm_u16x8_extend_low_u8x16(top_right), weights_low, keep_low),
+            lerp(wasm_u16x8_extend_low_u8x16(bottom_left), wasm_u16x8_extend_low_u8x16(bottom_right), weights_low, keep_low),
+            vertical, vertical_keep);
+        v128_t const high = lerp(
+            lerp(wasm_u16x8_extend_high_u8x16(top_left), wasm_u16x8_extend_high_u8x16(top_right), weights_high, keep_high),
+            lerp(wasm_u16x8_extend_high_u8x16(bottom_left), wasm_u16x8_extend_high_u8x16(bottom_right), weights_high, keep_high),
+            vertical, vertical_keep);
+        wasm_v128_store(&out[i], wasm_u8x16_narrow_i16x8(low, high));
+    }
+#endif
+    for (; i < out.size(); ++i) {
+        out[i] = lerp_pixel(
+            lerp_pixel(upper[from[i]], upper[to[i]], across[i]),
+            lerp_pixel(lower[from[i]], lower[to[i]], across[i]),
+            down);
+    }
+}
+
+// Division rounding towards negative infinity, for either sign of divisor
+int64_t floor_div(int64_t numerator, int64_t denominator)
+{
+    int64_t const quotient = numerator / denominator;
+    return numerator % denominator != 0 && (numerator < 0) != (denominator < 0) ? quotient - 1 : quotient;
+}
+
+// The x in [0, count) for which start + x * step lies within [low, high], as
+// the half open range [first, last)
+std::pair<int, int> span_within(int64_t start, int64_t step, int64_t low, int64_t high, int count)
+{
+    int64_t first = 0;
+    int64_t last = count;
+    if (step == 0) {
+        if (start < low || start > high) {
+            last = 0;
+        }
+    } else {
+        int64_t const lower_bound = step > 0 ? low : high;
+        int64_t const upper_bound = step > 0 ? high : low;
+        first = std::max(first, -floor_div(start - lower_bound, step));
+        last = std::min(last, floor_div(upper_bound - start, step) + 1);
+    }
+    first = std::min<int64_t>(first, count);
+    return { static_cast<int>(first), static_cast<int>(std::max(first, last)) };
+}
+
+// Enough steps around the circle that a corner, half the diagonal from the
+// center, moves at most two pixels from one to the next, and so lands within
+// a pixel of the exact angle. A multiple of four, so that right angles are
+// exact.
+size_t rotation_steps(float width, float height)
+{
+    float const radius = std::hypot(width, height) * 0.5F;
+    return 4 * static_cast<size_t>(std::max(std::ceil(std::numbers::pi_v<float> * 0.25F * radius), 1.F));
+}
+
+// Step nearest to angle
+size_t rotation_step(float angle, size_t steps)
+{
+    float const turns = angle / (2.F * std::numbers::pi_v<float>);
+    return static_cast<size_t>(std::lround((turns - std::floor(turns)) * static_cast<float>(steps))) % steps;
+}
+
+float step_angle(size_t step, size_t steps)
+{
+    return static_cast<float>(step) * 2.F * std::numbers::pi_v<float> / static_cast<float>(steps);
+}
+
+// Whole pixels that hold a width x height sprite turned by angle, plus a
+// pixel on each side for its edges to fade out over. The slack keeps the
+// rounding error in the sine and cosine of right angles from adding a pixel.
+std::pair<int, int> rotated_size(float width, float height, float angle)
+{
+    constexpr float SLACK = 1.F / 256.F;
+    float const cos_angle = std::abs(std::cos(angle));
+    float const sin_angle = std::abs(std::sin(angle));
+    return {
+        static_cast<int>(std::ceil(width * cos_angle + height * sin_angle - SLACK)) + 2,
+        static_cast<int>(std::ceil(width * sin_angle + height * cos_angle - SLACK)) + 2,
+    };
+}
+
+// Resamples the level scaled to width x height and turned counterclockwise by
+// angle into a copy of rotated_size(), with the sprite's center at the copy's.
+// Each row maps back to a straight line through the level, walked in 16.16
+// fixed point over only the span where the bilinear taps reach the level. The
+// level is surrounded by transparent pixels, so the taps need no bounds
+// checks and the edges come out anti-aliased.
+Sprite::Level rotated(Sprite::Level const& level, float width, float height, float angle)
+{
+    auto const [copy_width, copy_height] = rotated_size(width, height, angle);
+    Sprite::Level copy { copy_width, copy_height, {} };
+    copy.pixels.resize(static_cast<size_t>(copy_width) * static_cast<size_t>(copy_height));
+
+    auto const padded_width = static_cast<size_t>(level.width) + 2;
+    std::vector<uint32_t> padded(padded_width * (static_cast<size_t>(level.height) + 2));
+    for (int y = 0; y < level.height; ++y) {
+        std::copy_n(level.pixels.begin() + static_cast<ptrdiff_t>(y) * level.width, level.width,
+            padded.begin() + static_cast<ptrdiff_t>((static_cast<size_t>(y) + 1) * padded_width + 1));
+    }
+
+    // Screen y points down, so turning counterclockwise on screen maps an
+    // offset (x, y) from the copy's center back to (x cos - y sin, x sin + y cos)
+    // from the sprite's. Positions are in padded pixels, relative to their
+    // centers.
+    float const cos_angle = std::cos(angle);
+    float const sin_angle = std::sin(angle);
+    float const scale_x = static_cast<float>(level.width) / width;
+    float const scale_y = static_cast<float>(level.height) / height;
+    int32_t const step_x = to_fixed(cos_angle * scale_x);
+    int32_t const step_y = to_fixed(sin_angle * scale_y);
+    float const first_x = 0.5F - static_cast<float>(copy_width) * 0.5F;
+    int32_t const last_x = ((level.width + 1) << 16) - 1;
+    int32_t const last_y = ((level.height + 1) << 16) - 1;
+    for (int y = 0; y < copy_height; ++y) {
+        float const offset_y = static_cast<float>(y) + 0.5F - static_cast<float>(copy_height) * 0.5F;
+        int32_t const start_x = to_fixed((first_x * cos_angle - offset_y * sin_angle) * scale_x + static_cast<float>(level.width) * 0.5F + 0.5F);
+        int32_t const start_y = to_fixed((first_x * sin_angle + offset_y * cos_angle) * scale_y + static_cast<float>(level.height) * 0.5F + 0.5F);
+        auto const [first_across, last_across] = span_within(start_x, step_x, 0, last_x, copy_width);
+        auto const [first_down, last_down] = span_within(start_y, step_y, 0, last_y, copy_width);
+        int const first = std::max(first_across, first_down);
+        int const last = std::min(last_across, last_down);
+
+        uint32_t* out = copy.pixels.data() + static_cast<size_t>(y) * static_cast<size_t>(copy_width);
+        int32_t source_x = start_x + first * step_x;
+        int32_t source_y = start_y + first * step_y;
+        for (int x = first; x < last; ++x, source_x += step_x, source_y += step_y) {
+            uint32_t const* upper = padded.data() + static_cast<size_t>(source_y >> 16) * padded_width + static_cast<size_t>(source_x >> 16);
+            uint32_t const* lower = upper + padded_width;
+            auto const across = static_cast<uint32_t>(source_x >> 8) & 0xFFU;
+            out[x] = lerp_pixel(lerp_pixel(upper[0], upper[1], across), lerp_pixel(lower[0], lower[1], across),
+                static_cast<uint32_t>(source_y >> 8) & 0xFFU);
+        }
+    }
+    return copy;
+}
+
+}
+
+Sprite::Sprite(std::span<uint32_t const> pixels, int width, int height)
+{
+    Level level { width, height, {} };
+    level.pixels.reserve(pixels.size());
+    for (auto const pixel : pixels) {
+        uint32_t const alpha = pixel >> 24U;
+        level.pixels.push_back((scale_pixel(pixel, alpha) & 0x00FFFFFFU) | (alpha << 24U));
+    }
+    m_levels.push_back(std::move(level));
+    while (m_levels.back().width > 1 || m_levels.back().height > 1) {
+        m_levels.push_back(halved(m_levels.back()));
+    }
+}
+
+Sprite::Level const& Sprite::level_for(float width, float height) const
+{
+    size_t index = 0;
+    while (index + 1 < m_levels.size() && static_cast<float>(m_levels[index + 1].width) >= width
+        && static_cast<float>(m_levels[index + 1].height) >= height) {
+        ++index;
+    }
+    return m_levels[index];
+}
+
+PixelRect sprite_rect(pos2 center, float width, float height)
+{
+    float const left = center.x - width * 0.5F;
+    float const top = center.y - height * 0.5F;
+    return {
+        static_cast<int>(std::ceil(left - 0.5F)),
+        static_cast<int>(std::ceil(top - 0.5F)),
+        static_cast<int>(std::ceil(left + width - 0.5F)),
+        static_cast<int>(std::ceil(top + height - 0.5F)),
+    };
+}
+
+// Walks the source position of each canvas pixel center in 16.16 fixed point.
+// Nearest takes the source pixel that position falls in. Bilinear takes the
+// one up and left of it, relative to pixel centers, and blends towards the
+// next by the fraction. The canvas is covered in strips of up to 64 columns,
+// so that the source columns and weights are worked out once per strip
+// rather than once per row. The filtered pixels of each row of a strip are
+// gathered and composited with blend_over().
+void draw_sprite(Sprite const& sprite, pos2 center, float width, float height, PixelRect clip,
+    SpriteFilter filter, std::span<uint32_t> canvas, size_t canvas_width)
+{
+    if (sprite.empty() || !(width > 0.F) || !(height > 0.F) || canvas_width == 0) {
+        return;
+    }
+    PixelRect const canvas_rect = { 0, 0, static_cast<int>(canvas_width), static_cast<int>(canvas.size() / canvas_width) };
+    PixelRect const visible = sprite_rect(center, width, height).intersected(clip).intersected(canvas_rect);
+    if (visible.empty()) {
+        return;
+    }
+
+    auto const& level = sprite.level_for(width, height);
+    float const scale_x = static_cast<float>(level.width) / width;
+    float const scale_y = static_cast<float>(level.height) / height;
+    float const bias = filter == SpriteFilter::BILINEAR ? -0.5F : 0.F;
+    float const left = center.x - width * 0.5F;
+    float const top = center.y - height * 0.5F;
+    int32_t const step_x = to_fixed(scale_x);
+    int32_t const step_y = to_fixed(scale_y);
+    int32_t const start_x = to_fixed((static_cast<float>(visible.left) + 0.5F - left) * scale_x + bias);
+    int32_t const start_y = to_fixed((static_cast<float>(visible.top) + 0.5F - top) * scale_y + bias);
+    // Bilinear at the level's own size, aligned to whole pixels, only ever
+    // takes the first of each pair
+    if (step_x == 65536 && step_y == 65536 && (start_x & 0xFFFF) == 0 && (start_y & 0xFFFF) == 0) {
+        filter = SpriteFilter::NEAREST;
+    }
+
+    auto const row = [&](int32_t source) {
+        int const y = std::clamp(source >> 16, 0, level.height - 1);
+        return level.pixels.data() + static_cast<size_t>(y) * static_cast<size_t>(level.width);
+    };
+
+    static constexpr size_t STRIP = 64;
+    std::array<int, STRIP> from {};
+    std::array<int, STRIP> to {};
+    std::array<uint32_t, STRIP> across {};
+    std::array<uint32_t, STRIP> gathered {};
+    for (int x = visible.left; x < visible.right; x += static_cast<int>(STRIP)) {
+        auto const count = std::min(STRIP, static_cast<size_t>(visible.right - x));
+        int32_t source_x = start_x + (x - visible.left) * step_x;
+        for (size_t i = 0; i < count; ++i, source_x += step_x) {
+            from[i] = std::clamp(source_x >> 16, 0, level.width - 1);
+            to[i] = std::min((source_x >> 16) + 1, level.width - 1);
+            across[i] = static_cast<uint32_t>(source_x >> 8) & 0xFFU;
+        }
+
+        int32_t source_y = start_y;
+        for (int y = visible.top; y < visible.bottom; ++y, source_y += step_y) {
+            uint32_t const* upper = row(source_y);
+            if (filter == SpriteFilter::NEAREST) {
+                for (size_t i = 0; i < count; ++i) {
+                    gathered[i] = upper[from[i]];
+                }
+            } else {
+                filter_rows(std::span(gathered).first(count), upper, row(source_y + 65536),
+                    from.data(), to.data(), across.data(), static_cast<uint32_t>(source_y >> 8) & 0xFFU);
+            }
+            uint32_t* target = canvas.data() + static_cast<size_t>(y) * canvas_width + x;
+            blend_over(std::span(target, count), std::span(gathered).first(count));
+        }
+    }
+}
+
+RotatedSprite::RotatedSprite(Sprite sprite, size_t budget)
+    : m_sprite(std::move(sprite))
+    , m_budget(budget)
+{
+}
+
+// The copy sits on whole pixels, centered as near to center as it can be
+PixelRect RotatedSprite::rect(pos2 center, float width, float height, float angle) const
+{
+    if (m_sprite.empty() || !(width > 0.F) || !(height > 0.F)) {
+        return {};
+    }
+    auto const steps = rotation_steps(width, height);
+    auto const [copy_width, copy_height] = rotated_size(width, height, step_angle(rotation_step(angle, steps), steps));
+    auto const left = static_cast<int>(std::lround(center.x - static_cast<float>(copy_width) * 0.5F));
+    auto const top = static_cast<int>(std::lround(center.y - static_cast<float>(copy_height) * 0.5F));
+    return { left, top, left + copy_width, top + copy_height };
+}
+
+void RotatedSprite::draw(pos2 center, float width, float height, float angle, PixelRect clip,
+    std::span<uint32_t> canvas, size_t canvas_width)
+{
+    if (canvas_width == 0) {
+        return;
+    }
+    PixelRect const canvas_rect = { 0, 0, static_cast<int>(canvas_width), static_cast<int>(canvas.size() / canvas_width) };
+    PixelRect const covered = rect(center, width, height, angle);
+    PixelRect const visible = covered.intersected(clip).intersected(canvas_rect);
+    if (visible.empty()) {
+        return;
+    }
+
+    if (width != m_width || height != m_height) {
+        m_copies.assign(rotation_steps(width, height), {});
+        m_bytes = 0;
+        m_width = width;
+        m_height = height;
+    }
+    auto const step = rotation_step(angle, m_copies.size());
+    auto& copy = m_copies[step];
+    if (copy.pixels.empty()) {
+        copy = rotated(m_sprite.level_for(width, height), width, height, step_angle(step, m_copies.size()));
+        m_bytes += copy.pixels.size() * sizeof(uint32_t);
+        evict_around(step);
+    }
+
+    auto const count = static_cast<size_t>(visible.right - visible.left);
+    for (int y = visible.top; y < visible.bottom; ++y) {
+        auto const source = static_cast<size_t>(y - covered.top) * static_cast<size_t>(copy.width) + static_cast<size_t>(visible.left - covered.left);
+        auto const target = static_cast<size_t>(y) * canvas_width + static_cast<size_t>(visible.left);
+        blend_over(canvas.subspan(target, count), std::span<uint32_t const>(copy.pixels).subspan(source, count));
+    }
+}
+
+void RotatedSprite::evict_around(size_t step)
+{
+    auto const steps = m_copies.size();
+    while (m_bytes > m_budget) {
+        size_t farthest = step;
+        size_t farthest_distance = 0;
+        for (size_t i = 0; i < steps; ++i) {
+            auto const distance = std::min((i + steps - step) % steps, (step + steps - i) % steps);
+            if (!m_copies[i].pixels.empty() && distance > farthest_distance) {
+                farthest = i;
+                farthest_distance = distance;
+            }
+        }
+        if (farthest == step) {
+            return;
+        }
+        m_bytes -= m_copies[farthest].pixels.size() * sizeof(uint32_t);
+        m_copies[farthest] = {};
+    }
+}
+
+// Four pixels at a time where SIMD is available. Each channel of the target
+// is widened to 16 bits, multiplied by 255 - alpha of its source pixel and
+// divided by 255 with the same exact rounding as scale_pixel(). Groups that
+// are entirely transparent or opaque, which is most of a typical sprite, skip
+// the math.
+void blend_over(std::span<uint32_t> target, std::span<uint32_t const> source)
+{
+    size_t i = 0;
+#if defined(CHAMBER_SSE2)
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const full = _mm_set1_epi32(255);
+    __m128i const half = _mm_set1_epi16(128);
+    auto const divide = [&](__m128i product) {
+        product = _mm_add_epi16(product, half);
+        return _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+    };
+    for (; i + 4 <= source.size(); i += 4) {
+        __m128i const src = _mm_loadu_si128(reinterpret_cast<__m128i const*>(&source[i]));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(src, zero)) == 0xFFFF) {
+            continue;
+        }
+        __m128i const alpha = _mm_srli_epi32(src, 24);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, full)) == 0xFFFF) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&target[i]), src);
+            continue;
+        }
+        __m128i inverse = _mm_sub_epi32(full, alpha);
+        inverse = _mm_or_si128(inverse, _mm_slli_epi32(inverse, 16));
+        __m128i const dst = _mm_loadu_si128(reinterpret_cast<__m128i const*>(&target[i]));
+        __m128i const low = divide(_mm_mullo_epi16(_mm_unpacklo_epi8(dst, zero), _mm_unpacklo_epi32(inverse, inverse)));
+        __m128i const high = divide(_mm_mullo_epi16(_mm_unpackhi_epi8(dst, zero), _mm_unpackhi_epi32(inverse, inverse)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&target[i]), _mm_add_epi8(src, _mm_packus_epi16(low, high)));
+    }
+#elif defined(CHAMBER_SIMD128)
+    v128_t const full = wasm_i32x4_splat(255);
+    v128_t const half = wasm_i16x8_splat(128);
+    auto const divide = [&](v128_t product) {
+        product = wasm_i16x8_add(product, half);
+        return wasm_u16x8_shr(wasm_i16x8_add(product, wasm_u16x8_shr(product, 8)), 8);
+    };
+    for (; i + 4 <= source.size(); i += 4) {
+        v128_t const src = wasm_v128_load(&source[i]);
+        if (!wasm_v128_any_true(src)) {
+            continue;
+        }
+        v128_t const alpha = wasm_u32x4_shr(src, 24);
+        if (wasm_i32x4_all_true(wasm_i32x4_eq(alpha, full))) {
+            wasm_v128_store(&target[i], src);
+            continue;
+        }
+        v128_t inverse = wasm_i32x4_sub(full, alpha);
+        inverse = wasm_v128_or(inverse, wasm_i32x4_shl(inverse, 16));
+        v128_t const dst = wasm_v128_load(&target[i]);
+        v128_t const low = divide(wasm_i16x8_mul(wasm_u16x8_extend_low_u8x16(dst), wasm_i32x4_shuffle(inverse, inverse, 0, 0, 1, 1)));
+        v128_t const high = divide(wasm_i16x8_mul(wasm_u16x8_extend_high_u8x16(dst), wasm_i32x4_shuffle(inverse, inverse, 2, 2, 3, 3)));
+        wasm_v128_store(&target[i], wasm_i8x16_add(src, wasm_u8x16_narrow_i16x8(low, high)));
+    }
+#endif
+    for (; i < source.size(); ++i) {
+        target[i] = blend_pixel(target[i], source[i]);
+    }
+}
+
+}
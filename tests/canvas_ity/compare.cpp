@@ -0,0 +1,184 @@
+// Compares the scenes rendered by two configurations of canvas_ity, failing
+// if any pixel differs by more than the bound the configuration promises.
+// The time each took to render is printed alongside, for reference only,
+// since timings are too noisy to fail a test on.
+//
+// Usage: canvas_ity_compare <configuration>
+
+#include "renders.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace canvas_test {
+
+char const* scene_name(Scene scene)
+{
+    switch (scene) {
+    case Scene::SHAPES:
+        return "shapes";
+    case Scene::SHADOWS:
+        return "shadows";
+    case Scene::COMPOSITING:
+        return "compositing";
+    case Scene::POLYGON:
+        return "polygon";
+    case Scene::IMAGES:
+        return "images";
+    case Scene::TRANSFER:
+        return "transfer";
+    case Scene::INSTANCED:
+        return "instanced";
+    case Scene::RETAINED:
+        return "retained";
+    case Scene::TEXT:
+        return "text";
+    case Scene::IMAGE_FILTERS:
+        return "filters";
+    case Scene::INSTANCED_PER_COPY:
+        return "per copy";
+    case Scene::RETAINED_IMMEDIATE:
+        return "immediate";
+    case Scene::TEXT_UNCACHED:
+        return "uncached";
+    case Scene::IMAGE_FILTERS_REPLICATED:
+        return "replicated";
+    }
+    return "?";
+}
+
+}
+
+namespace {
+
+using canvas_test::Scene;
+using Renderer = std::function<std::vector<unsigned char>(Scene)>;
+
+// Channels are compared premultiplied, as they are seen once composited, so
+// that colors of nearly transparent pixels do not count for more than they
+// show
+int premultiplied(std::span<unsigned char const> pixel, size_t channel)
+{
+    return channel == 3 ? pixel[3] : (pixel[channel] * pixel[3] + 127) / 255;
+}
+
+struct Difference {
+    int max; // In 8-bit levels
+    size_t differing; // Channels that differ at all
+};
+
+Difference difference(std::span<unsigned char const> expected, std::span<unsigned char const> actual)
+{
+    Difference result {};
+    for (size_t i = 0; i < expected.size(); i += 4) {
+        auto const expected_pixel = expected.subspan(i, 4);
+        auto const actual_pixel = actual.subspan(i, 4);
+        for (size_t channel = 0; channel < 4; ++channel) {
+            int const levels = std::abs(premultiplied(expected_pixel, channel) - premultiplied(actual_pixel, channel));
+            result.max = std::max(result.max, levels);
+            result.differing += levels != 0 ? 1 : 0;
+        }
+    }
+    return result;
+}
+
+// Renders the scene, returning the pixels and the milliseconds it took
+std::pair<std::vector<unsigned char>, double> timed(Renderer const& renderer, Scene scene)
+{
+    auto const start = std::chrono::steady_clock::now();
+    auto pixels = renderer(scene);
+    std::chrono::duration<double, std::milli> const elapsed = std::chrono::steady_clock::now() - start;
+    return { std::move(pixels), elapsed.count() };
+}
+
+// Every scene rendered by actual is within max_levels of the same scene, or
+// the one paired with it, rendered by expected, where a max_levels of 0 asks
+// for the same bytes, colors of transparent pixels and all
+bool compare(char const* label, Renderer const& expected, Renderer const& actual, int max_levels,
+    std::span<std::pair<Scene, Scene> const> scenes)
+{
+    bool passed = true;
+    for (auto const& [scene, expected_scene] : scenes) {
+        auto const [expected_pixels, expected_ms] = timed(expected, expected_scene);
+        auto const [actual_pixels, actual_ms] = timed(actual, scene);
+        auto const [max, differing] = difference(expected_pixels, actual_pixels);
+        bool const within = max_levels == 0 ? expected_pixels == actual_pixels : max <= max_levels;
+        std::printf("%-9s %-12s max %3d levels, %6zu of %zu channels differ, %7.2f ms against %7.2f ms%s\n", label,
+            canvas_test::scene_name(scene), max, differing, expected_pixels.size(), actual_ms, expected_ms,
+            within ? "" : "  FAILED");
+        passed = passed && within;
+    }
+    return passed;
+}
+
+// Each of the scenes against itself
+bool compare(char const* label, Renderer const& expected, Renderer const& actual, int max_levels,
+    std::span<Scene const> scenes = canvas_test::SCENES)
+{
+    std::vector<std::pair<Scene, Scene>> pairs;
+    for (auto const scene : scenes) {
+        pairs.emplace_back(scene, scene);
+    }
+    return compare(label, expected, actual, max_levels, pairs);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: %s <configuration>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    std::string_view const configuration = argv[1];
+    Renderer const float_bitmap = [](Scene scene) { return canvas_ity_float::render_scene(scene, 1); };
+
+    bool passed = false;
+    if (configuration == "reference") {
+        // Sums the coverage of runs on the same pixel in another order since
+        // the radix sort, and blends and resamples with SIMD, so only the
+        // last float bits differ, enough to tip a channel to the neighboring
+        // level when dithered on output
+        passed = compare("reference", [](Scene scene) { return canvas_ity_reference::render_scene(scene, 1); },
+            float_bitmap, 1, canvas_test::V100_SCENES);
+    } else if (configuration == "compact") {
+        // Rounds to 8 bits after every draw, where the float bitmap rounds
+        // once when read back
+        passed = compare("compact", float_bitmap, [](Scene scene) { return canvas_ity_compact::render_scene(scene, 1); }, 3);
+    } else if (configuration == "fixed") {
+        // Snaps the path to 1/256 of a pixel, which moves the coverage of
+        // edge pixels by a fraction of a percent
+        passed = compare("fixed", float_bitmap, [](Scene scene) { return canvas_ity_fixed::render_scene(scene, 1); }, 2);
+    } else if (configuration == "threads") {
+        // Each band composites exactly the rows the serial loop would
+        Renderer const compact_bitmap = [](Scene scene) { return canvas_ity_compact::render_scene(scene, 1); };
+        passed = true;
+        for (int const threads : { 1, 2, 4, 8 }) {
+            std::printf("%d thread(s)\n", threads);
+            passed = compare("float", float_bitmap,
+                         [threads](Scene scene) { return canvas_ity_threads::render_scene(scene, threads); }, 0)
+                && passed;
+            passed = compare("compact", compact_bitmap,
+                         [threads](Scene scene) { return canvas_ity_threads_compact::render_scene(scene, threads); }, 0)
+                && passed;
+        }
+    } else if (configuration == "shortcuts") {
+        // Each shortcut rasterizes and composites just what the long way
+        // round would
+        Renderer const compact_bitmap = [](Scene scene) { return canvas_ity_compact::render_scene(scene, 1); };
+        Renderer const fixed_point = [](Scene scene) { return canvas_ity_fixed::render_scene(scene, 1); };
+        passed = compare("float", float_bitmap, float_bitmap, 0, canvas_test::SHORTCUTS);
+        passed = compare("compact", compact_bitmap, compact_bitmap, 0, canvas_test::SHORTCUTS) && passed;
+        passed = compare("fixed", fixed_point, fixed_point, 0, canvas_test::SHORTCUTS) && passed;
+    } else {
+        std::fprintf(stderr, "Unknown configuration %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
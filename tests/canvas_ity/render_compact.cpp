@@ -0,0 +1,7 @@
+// Pixels kept as premultiplied sRGB RGBA8 and blended in 16-bit fixed point
+#define CANVAS_ITY_IMPLEMENTATION
+#define CANVAS_ITY_COMPACT_BITMAP
+#define canvas_ity canvas_ity_compact
+#include <canvas_ity/canvas_ity.hpp>
+
+#include "scenes.hpp"
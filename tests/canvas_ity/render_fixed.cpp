@@ -0,0 +1,7 @@
+// The float bitmap with paths scan converted in 24.8 fixed point
+#define CANVAS_ITY_IMPLEMENTATION
+#define CANVAS_ITY_FIXED_POINT
+#define canvas_ity canvas_ity_fixed
+#include <canvas_ity/canvas_ity.hpp>
+
+#include "scenes.hpp"
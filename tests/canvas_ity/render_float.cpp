@@ -0,0 +1,6 @@
+// The default configuration, with the pixels kept as linear float RGBA
+#define CANVAS_ITY_IMPLEMENTATION
+#define canvas_ity canvas_ity_float
+#include <canvas_ity/canvas_ity.hpp>
+
+#include "scenes.hpp"
@@ -0,0 +1,8 @@
+// canvas_ity v1.00 as vendored before any of the local changes, which the
+// other configurations are checked and timed against
+#define CANVAS_ITY_IMPLEMENTATION
+#define canvas_ity canvas_ity_reference
+#include "reference/canvas_ity.hpp"
+
+#define CANVAS_TEST_V100_API
+#include "scenes.hpp"
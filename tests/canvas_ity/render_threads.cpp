@@ -0,0 +1,8 @@
+// The float bitmap composited in parallel bands once set_thread_count() is
+// called
+#define CANVAS_ITY_IMPLEMENTATION
+#define CANVAS_ITY_THREADS
+#define canvas_ity canvas_ity_threads
+#include <canvas_ity/canvas_ity.hpp>
+
+#include "scenes.hpp"
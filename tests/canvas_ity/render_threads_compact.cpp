@@ -0,0 +1,9 @@
+// The compact bitmap composited in parallel bands, which goes through the
+// same 8-bit path as drawing onto an external image
+#define CANVAS_ITY_IMPLEMENTATION
+#define CANVAS_ITY_COMPACT_BITMAP
+#define CANVAS_ITY_THREADS
+#define canvas_ity canvas_ity_threads_compact
+#include <canvas_ity/canvas_ity.hpp>
+
+#include "scenes.hpp"
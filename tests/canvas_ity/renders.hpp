@@ -0,0 +1,88 @@
+#ifndef RENDERS_HPP
+#define RENDERS_HPP
+
+#include <utility>
+#include <vector>
+
+// Each configuration of canvas_ity under test is compiled into a namespace of
+// its own by one of the render_*.cpp files, so they can all be linked into
+// one test and render the same scenes from scenes.hpp side by side.
+namespace canvas_test {
+
+static constexpr int SCENE_WIDTH = 256;
+static constexpr int SCENE_HEIGHT = 192;
+
+enum class Scene {
+    SHAPES, // Gradients, strokes, dashes and stacked translucent circles
+    SHADOWS, // Blurred and offset shadows
+    COMPOSITING, // Each compositing operation within a clip
+    POLYGON, // Large self-intersecting polygon, filled and stroked
+    IMAGES, // Pattern fill under a rotated, magnified translucent image
+    TRANSFER, // put_image_data() of noise, drawn over and read back
+    // Through the API added since v1.00, so not rendered by the reference
+    INSTANCED, // Copies of a retained path, crossing every canvas edge
+    RETAINED, // Retained path redrawn under new transforms and line styles
+    TEXT, // Lines of text, drawn again after the glyph cache evicts them
+    IMAGE_FILTERS, // Nearest and bilinear images, magnified, rotated and shrunk
+    // The long way round of drawing the scenes above
+    INSTANCED_PER_COPY, // Each copy translated and filled on its own
+    RETAINED_IMMEDIATE, // Path built afresh for every draw
+    TEXT_UNCACHED, // Font set again before every string, emptying the cache
+    IMAGE_FILTERS_REPLICATED, // Magnified by repeating pixels in the image
+};
+
+// Drawn only through the API of canvas_ity v1.00
+static constexpr Scene V100_SCENES[] = {
+    Scene::SHAPES,
+    Scene::SHADOWS,
+    Scene::COMPOSITING,
+    Scene::POLYGON,
+    Scene::IMAGES,
+    Scene::TRANSFER,
+};
+
+// Every scene, other than the long ways round
+static constexpr Scene SCENES[] = {
+    Scene::SHAPES,
+    Scene::SHADOWS,
+    Scene::COMPOSITING,
+    Scene::POLYGON,
+    Scene::IMAGES,
+    Scene::TRANSFER,
+    Scene::INSTANCED,
+    Scene::RETAINED,
+    Scene::TEXT,
+    Scene::IMAGE_FILTERS,
+};
+
+// Scenes drawn through a shortcut that promises the same pixels as drawing
+// them the long way round, paired with that
+static constexpr std::pair<Scene, Scene> SHORTCUTS[] = {
+    { Scene::INSTANCED, Scene::INSTANCED_PER_COPY },
+    { Scene::RETAINED, Scene::RETAINED_IMMEDIATE },
+    { Scene::TEXT, Scene::TEXT_UNCACHED },
+    { Scene::IMAGE_FILTERS, Scene::IMAGE_FILTERS_REPLICATED },
+};
+
+[[nodiscard]] char const* scene_name(Scene scene);
+
+// TrueType font with a distinct glyph for each printable ASCII character
+[[nodiscard]] std::vector<unsigned char> const& test_font();
+
+}
+
+// Renders the scene as RGBA8 rows from get_image_data(). threads is only used
+// by configurations compiled with CANVAS_ITY_THREADS.
+#define CANVAS_TEST_CONFIGURATION(name)                                             \
+    namespace name {                                                                \
+    std::vector<unsigned char> render_scene(canvas_test::Scene scene, int threads); \
+    }
+
+CANVAS_TEST_CONFIGURATION(canvas_ity_reference)
+CANVAS_TEST_CONFIGURATION(canvas_ity_float)
+CANVAS_TEST_CONFIGURATION(canvas_ity_compact)
+CANVAS_TEST_CONFIGURATION(canvas_ity_threads)
+CANVAS_TEST_CONFIGURATION(canvas_ity_threads_compact)
+CANVAS_TEST_CONFIGURATION(canvas_ity_fixed)
+
+#endif // RENDERS_HPP
@@ -0,0 +1,565 @@
+#ifndef SCENES_HPP
+#define SCENES_HPP
+
+// The fixed scenes rendered by every configuration. Included by the
+// render_*.cpp files after canvas_ity, with canvas_ity defined to the
+// namespace of the configuration. The reference defines
+// CANVAS_TEST_V100_API, which leaves out the scenes that need the API added
+// since canvas_ity v1.00.
+
+#include "renders.hpp"
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <numbers>
+#include <vector>
+
+namespace canvas_ity {
+
+namespace {
+
+// Same sequence on every platform, unlike the standard distributions
+class Noise {
+public:
+    explicit Noise(uint32_t seed)
+        : m_state(seed)
+    {
+    }
+
+    uint32_t next()
+    {
+        m_state ^= m_state << 13U;
+        m_state ^= m_state >> 17U;
+        m_state ^= m_state << 5U;
+        return m_state;
+    }
+    float next(float from, float to) { return from + (to - from) * static_cast<float>(next() >> 8U) / 16777216.F; }
+
+private:
+    uint32_t m_state;
+};
+
+constexpr float PI = std::numbers::pi_v<float>;
+constexpr auto WIDTH = static_cast<float>(canvas_test::SCENE_WIDTH);
+constexpr auto HEIGHT = static_cast<float>(canvas_test::SCENE_HEIGHT);
+
+// Translucent 16x16 image with hard edges, which the bicubic filter
+// overshoots past 0 and 1 on when magnified
+std::vector<unsigned char> checker_image(unsigned char alpha)
+{
+    std::vector<unsigned char> image(16 * 16 * 4);
+    for (size_t y = 0; y < 16; ++y) {
+        for (size_t x = 0; x < 16; ++x) {
+            unsigned char* pixel = &image[(y * 16 + x) * 4];
+            bool const odd = ((x / 4) + (y / 4)) % 2 != 0;
+            pixel[0] = odd ? 255 : 10;
+            pixel[1] = static_cast<unsigned char>(x * 16);
+            pixel[2] = odd ? 30 : 240;
+            pixel[3] = alpha;
+        }
+    }
+    return image;
+}
+
+void draw_shapes(canvas& context)
+{
+    context.set_linear_gradient(fill_style, 0, 0, WIDTH, HEIGHT);
+    context.add_color_stop(fill_style, 0.F, 0.1F, 0.2F, 0.6F, 1.F);
+    context.add_color_stop(fill_style, 0.5F, 0.9F, 0.9F, 0.8F, 1.F);
+    context.add_color_stop(fill_style, 1.F, 0.6F, 0.1F, 0.1F, 1.F);
+    context.fill_rectangle(0, 0, WIDTH, HEIGHT);
+
+    context.set_radial_gradient(fill_style, 80, 70, 5, 90, 90, 60);
+    context.add_color_stop(fill_style, 0.F, 1.F, 1.F, 0.F, 0.9F);
+    context.add_color_stop(fill_style, 1.F, 0.F, 0.5F, 0.2F, 0.2F);
+    context.begin_path();
+    context.arc(90, 90, 60, 0, 2 * PI);
+    context.fill();
+
+    context.set_line_width(6);
+    context.line_join = rounded;
+    context.line_cap = circle;
+    context.set_color(stroke_style, 0.1F, 0.1F, 0.3F, 0.8F);
+    context.begin_path();
+    context.move_to(20, 170);
+    context.bezier_curve_to(60, 20, 140, 220, 230, 30);
+    context.stroke();
+
+    float const dashes[] = { 12, 5, 3, 5 };
+    context.set_line_dash(dashes, 4);
+    context.set_line_width(2.5F);
+    context.line_join = miter;
+    context.line_cap = butt;
+    context.set_color(stroke_style, 0.9F, 0.2F, 0.4F, 1.F);
+    context.begin_path();
+    context.move_to(150, 20);
+    context.line_to(240, 60);
+    context.line_to(170, 110);
+    context.line_to(245, 175);
+    context.stroke();
+    context.set_line_dash(nullptr, 0);
+
+    Noise noise(1);
+    for (int i = 0; i < 20; ++i) {
+        context.set_color(fill_style, noise.next(0, 1), noise.next(0, 1), noise.next(0, 1), 0.15F);
+        context.begin_path();
+        context.arc(170 + static_cast<float>(i) * 2.F, 120 - static_cast<float>(i), 40, 0, 2 * PI);
+        context.fill();
+    }
+}
+
+void draw_shadows(canvas& context)
+{
+    context.set_color(fill_style, 0.95F, 0.95F, 0.9F, 1.F);
+    context.fill_rectangle(0, 0, WIDTH, HEIGHT);
+
+    context.set_shadow_color(0.F, 0.F, 0.2F, 0.6F);
+    context.set_shadow_blur(8);
+    context.shadow_offset_x = 6;
+    context.shadow_offset_y = 4;
+    context.set_color(fill_style, 0.2F, 0.6F, 0.9F, 1.F);
+    context.fill_rectangle(30, 30, 80, 60);
+
+    context.set_shadow_blur(3);
+    context.shadow_offset_x = -3;
+    context.set_color(fill_style, 0.9F, 0.5F, 0.1F, 0.7F);
+    context.begin_path();
+    context.arc(170, 110, 50, 0, 2 * PI);
+    context.fill();
+
+    context.set_shadow_blur(15);
+    context.shadow_offset_y = 10;
+    context.set_line_width(4);
+    context.set_color(stroke_style, 0.1F, 0.4F, 0.1F, 1.F);
+    context.stroke_rectangle(40, 120, 90, 50);
+}
+
+void draw_compositing(canvas& context)
+{
+    static constexpr composite_operation OPERATIONS[] = {
+        source_atop,
+        source_in,
+        source_out,
+        destination_over,
+        destination_out,
+        lighter,
+        exclusive_or,
+        source_copy,
+    };
+
+    for (size_t i = 0; i < std::size(OPERATIONS); ++i) {
+        float const left = static_cast<float>(i % 4) * 64;
+        float const top = static_cast<float>(i / 4) * 96;
+        context.save();
+        context.begin_path();
+        context.arc(left + 32, top + 48, 30, 0, 2 * PI);
+        context.clip();
+        context.set_color(fill_style, 0.2F, 0.3F, 0.8F, 0.7F);
+        context.fill_rectangle(left + 4, top + 10, 40, 50);
+        context.global_composite_operation = OPERATIONS[i];
+        context.set_color(fill_style, 0.9F, 0.4F, 0.1F, 0.6F);
+        context.begin_path();
+        context.arc(left + 40, top + 56, 22, 0, 2 * PI);
+        context.fill();
+        context.restore();
+    }
+}
+
+void draw_polygon(canvas& context)
+{
+    context.set_color(fill_style, 1.F, 1.F, 1.F, 1.F);
+    context.fill_rectangle(0, 0, WIDTH, HEIGHT);
+
+    Noise noise(2);
+    context.begin_path();
+    context.move_to(WIDTH / 2, HEIGHT / 2);
+    for (int i = 0; i < 400; ++i) {
+        context.line_to(noise.next(4, WIDTH - 4), noise.next(4, HEIGHT - 4));
+    }
+    context.close_path();
+    context.set_color(fill_style, 0.3F, 0.1F, 0.5F, 0.5F);
+    context.fill();
+    context.set_line_width(2.5F);
+    context.set_color(stroke_style, 0.F, 0.3F, 0.2F, 0.4F);
+    context.stroke();
+}
+
+void draw_images(canvas& context)
+{
+    auto const pattern = checker_image(255);
+    context.set_pattern(fill_style, pattern.data(), 16, 16, 16 * 4, repeat);
+    context.fill_rectangle(0, 0, WIDTH, HEIGHT);
+
+    auto const image = checker_image(160);
+    context.rotate(0.3F);
+    context.draw_image(image.data(), 16, 16, 16 * 4, 60, -10, 120, 120);
+    context.set_global_alpha(0.5F);
+    context.draw_image(image.data(), 16, 16, 16 * 4, 20, 80, 40, 30);
+}
+
+void draw_transfer(canvas& context)
+{
+    static constexpr int SIZE = canvas_test::SCENE_WIDTH * canvas_test::SCENE_HEIGHT * 4;
+    std::vector<unsigned char> noise_image(SIZE);
+    Noise noise(3);
+    for (size_t i = 0; i < noise_image.size(); i += 4) {
+        uint32_t const bits = noise.next();
+        unsigned char const alpha = (bits & 3U) == 0 ? 255 : static_cast<unsigned char>(bits >> 24U);
+        // Straight alpha, so keep the colors meaningful at any alpha
+        noise_image[i + 0] = static_cast<unsigned char>(bits);
+        noise_image[i + 1] = static_cast<unsigned char>(bits >> 8U);
+        noise_image[i + 2] = static_cast<unsigned char>(bits >> 16U);
+        noise_image[i + 3] = alpha;
+    }
+    context.put_image_data(noise_image.data(), canvas_test::SCENE_WIDTH, canvas_test::SCENE_HEIGHT,
+        canvas_test::SCENE_WIDTH * 4, 0, 0);
+
+    context.set_color(fill_style, 0.1F, 0.8F, 0.3F, 0.5F);
+    context.begin_path();
+    context.arc(WIDTH / 2, HEIGHT / 2, 70, 0, 2 * PI);
+    context.fill();
+}
+
+#ifndef CANVAS_TEST_V100_API
+
+// Square frame with edges on a 1/16 pixel grid, wound the other way round
+// the hole, so that nothing rounds when it is moved by quarter pixels
+void build_marker(canvas& context)
+{
+    context.begin_path();
+    context.move_to(-7.5F, -6.25F);
+    context.line_to(7.5F, -6.25F);
+    context.line_to(7.5F, 6.25F);
+    context.line_to(-7.5F, 6.25F);
+    context.close_path();
+    context.move_to(-2.0625F, -2.F);
+    context.line_to(-2.0625F, 3.F);
+    context.line_to(2.5F, 3.F);
+    context.line_to(2.5F, -2.F);
+    context.close_path();
+}
+
+// Offsets on the quarter pixel grid from past the top left corner of the
+// canvas to past the bottom right one, and a few wholly off it
+std::vector<float> marker_positions(float scale)
+{
+    std::vector<float> positions;
+    for (float y = -5.75F; y < HEIGHT / scale + 12; y += 21.75F / scale) {
+        for (float x = -5.75F; x < WIDTH / scale + 12; x += 23.25F / scale) {
+            positions.push_back(x);
+            positions.push_back(y);
+        }
+    }
+    for (float const offset : { -40.F, WIDTH + 40, HEIGHT + 40 }) {
+        positions.push_back(offset);
+        positions.push_back(offset);
+    }
+    return positions;
+}
+
+// Draws the markers of the instanced scene through each copy of the
+// retained path at once, or else translated to each in turn
+void draw_markers(canvas& context, retained_path& marker, std::vector<float> const& positions, bool instanced)
+{
+    int const count = static_cast<int>(positions.size() / 2);
+    if (instanced) {
+        context.fill(marker, positions.data(), count);
+        context.stroke(marker, positions.data(), count);
+        return;
+    }
+    for (bool const stroking : { false, true }) {
+        for (int i = 0; i < count; ++i) {
+            context.save();
+            context.translate(positions[2 * i], positions[2 * i + 1]);
+            if (stroking) {
+                context.stroke(marker);
+            } else {
+                context.fill(marker);
+            }
+            context.restore();
+        }
+    }
+}
+
+void draw_instanced(canvas& context, bool instanced)
+{
+    context.set_color(fill_style, 0.95F, 0.9F, 0.8F, 1.F);
+    context.fill_rectangle(0, 0, WIDTH, HEIGHT);
+
+    retained_path marker;
+    build_marker(context);
+    context.retain_path(marker);
+    context.set_line_width(1.5F);
+    context.set_color(fill_style, 0.2F, 0.4F, 0.8F, 0.6F);
+    context.set_color(stroke_style, 0.4F, 0.1F, 0.1F, 0.9F);
+    draw_markers(context, marker, marker_positions(1), instanced);
+
+    // At twice the scale, offsets on the eighth pixel grid land on quarter
+    // pixels
+    context.save();
+    context.scale(2, 2);
+    context.set_line_width(0.5F);
+    context.set_color(fill_style, 0.9F, 0.7F, 0.1F, 0.4F);
+    context.set_color(stroke_style, 0.1F, 0.3F, 0.1F, 0.7F);
+    std::vector<float> positions = marker_positions(2);
+    for (float& position : positions) {
+        position += 0.125F;
+    }
+    draw_markers(context, marker, positions, instanced);
+    context.restore();
+
+    // Each copy casts its own shadow
+    context.set_shadow_color(0.F, 0.F, 0.F, 0.5F);
+    context.set_shadow_blur(3);
+    context.shadow_offset_x = 2;
+    context.shadow_offset_y = 3;
+    context.set_color(fill_style, 0.8F, 0.2F, 0.5F, 1.F);
+    float const shadowed[] = { 30.25F, 40.5F, 130.75F, 96, 250.5F, 2.25F, -3.75F, 188.5F };
+    draw_markers(context, marker, { std::begin(shadowed), std::end(shadowed) }, instanced);
+}
+
+// Curves and sharp corners, open at one end. Only cubic curves and lines,
+// which land on the same points whether moved to a new transform or built
+// afresh under it, unlike arcs and quadratic curves.
+void build_ribbon(canvas& context)
+{
+    context.begin_path();
+    context.move_to(20, 60);
+    context.bezier_curve_to(60, -10, 110, 130, 150, 40);
+    context.line_to(230, 20);
+    context.bezier_curve_to(200, 90, 250, 150, 180, 170);
+    context.line_to(130, 130);
+    context.bezier_curve_to(130, 185, 50, 185, 50, 130);
+    context.line_to(60, 90);
+}
+
+// Draws the retained scene from the retained ribbon, or else from the ribbon
+// built afresh under the current transform
+void draw_ribbon(canvas& context, retained_path& ribbon, bool retained)
+{
+    if (retained) {
+        context.fill(ribbon);
+        context.stroke(ribbon);
+        return;
+    }
+    build_ribbon(context);
+    context.fill();
+    context.stroke();
+}
+
+void draw_retained(canvas& context, bool retained)
+{
+    context.set_color(fill_style, 0.9F, 0.95F, 1.F, 1.F);
+    context.fill_rectangle(0, 0, WIDTH, HEIGHT);
+
+    retained_path ribbon;
+    build_ribbon(context);
+    context.retain_path(ribbon);
+    context.begin_path();
+    context.set_color(fill_style, 0.3F, 0.6F, 0.2F, 0.5F);
+    context.set_color(stroke_style, 0.1F, 0.1F, 0.4F, 0.8F);
+    context.set_line_width(5);
+    draw_ribbon(context, ribbon, retained);
+
+    // Moved from the transform it was retained under, with a shadow
+    context.translate(WIDTH / 2, HEIGHT / 2);
+    context.rotate(0.4F);
+    context.scale(0.7F, 0.5F);
+    context.translate(-WIDTH / 2, -HEIGHT / 2);
+    context.set_shadow_color(0.2F, 0.F, 0.F, 0.5F);
+    context.set_shadow_blur(4);
+    context.shadow_offset_x = 3;
+    context.shadow_offset_y = -2;
+    context.set_color(fill_style, 0.8F, 0.3F, 0.1F, 0.6F);
+    draw_ribbon(context, ribbon, retained);
+
+    // New line styles under the same transform, then the cache as it stands
+    float const dashes[] = { 9, 4, 2, 4 };
+    context.set_line_dash(dashes, 4);
+    context.line_dash_offset = 3;
+    context.line_join = rounded;
+    context.line_cap = square;
+    context.set_line_width(3);
+    context.set_shadow_color(0.F, 0.F, 0.F, 0.F);
+    context.set_color(stroke_style, 0.9F, 0.9F, 0.1F, 0.9F);
+    draw_ribbon(context, ribbon, retained);
+    context.set_global_alpha(0.5F);
+    context.global_composite_operation = lighter;
+    draw_ribbon(context, ribbon, retained);
+}
+
+// Draws a string with the font at the given size, first setting the font
+// again to empty the glyph cache when not caching
+void draw_string(canvas& context, bool cached, float size, char const* text, float x, float y,
+    float maximum_width = 1.0e30F)
+{
+    auto const& font = canvas_test::test_font();
+    if (cached) {
+        context.set_font(nullptr, 0, size);
+    } else {
+        context.set_font(font.data(), static_cast<int>(font.size()), size);
+    }
+    context.fill_text(text, x, y, maximum_width);
+}
+
+void draw_text(canvas& context, bool cached)
+{
+    auto const& font = canvas_test::test_font();
+    context.set_font(font.data(), static_cast<int>(font.size()), 20);
+    context.set_color(fill_style, 1.F, 0.98F, 0.9F, 1.F);
+    context.fill_rectangle(0, 0, WIDTH, HEIGHT);
+
+    static constexpr char const* LINES[] = {
+        "Sphinx of black quartz",
+        "judge my vow! 0123456789",
+        "{[(<@#$%^&*>)]}~?",
+    };
+    context.set_color(fill_style, 0.1F, 0.2F, 0.4F, 1.F);
+    for (size_t i = 0; i < std::size(LINES); ++i) {
+        draw_string(context, cached, 14, LINES[i], 6, 18 + static_cast<float>(i) * 16);
+    }
+
+    // Every glyph, large enough to push the ones above out of the cache, but
+    // drawn wholly above the canvas
+    draw_string(context, cached, 120, "!\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ", 0, -200);
+    draw_string(context, cached, 120, "[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~", 0, -200);
+
+    // The same lines again, then at other sizes, angles and widths
+    context.set_color(fill_style, 0.5F, 0.1F, 0.2F, 0.8F);
+    for (size_t i = 0; i < std::size(LINES); ++i) {
+        draw_string(context, cached, 14, LINES[i], 10.25F, 76 + static_cast<float>(i) * 16);
+    }
+    draw_string(context, cached, 28, "Quartz", 8, 150, 100);
+    context.text_align = center;
+    draw_string(context, cached, 9, LINES[0], WIDTH / 2, HEIGHT - 6);
+    context.translate(190, 120);
+    context.rotate(-0.5F);
+    draw_string(context, cached, 18, LINES[1], 0, 0, 120);
+}
+
+// Noise image, enlarged by repeating each pixel over a square of them
+std::vector<unsigned char> noise_image(int size, int repeat)
+{
+    int const width = size * repeat;
+    std::vector<unsigned char> image(static_cast<size_t>(width * width * 4));
+    Noise noise(4);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            uint32_t const bits = noise.next();
+            for (int copy = 0; copy < repeat * repeat; ++copy) {
+                unsigned char* pixel = &image[static_cast<size_t>(
+                    ((y * repeat + copy / repeat) * width + x * repeat + copy % repeat) * 4)];
+                pixel[0] = static_cast<unsigned char>(bits);
+                pixel[1] = static_cast<unsigned char>(bits >> 8U);
+                pixel[2] = static_cast<unsigned char>(bits >> 16U);
+                pixel[3] = static_cast<unsigned char>(bits >> 24U | 0x40U);
+            }
+        }
+    }
+    return image;
+}
+
+void draw_image_filters(canvas& context, bool replicated)
+{
+    auto const pattern = checker_image(255);
+    context.image_filter = nearest;
+    context.save();
+    context.rotate(0.2F);
+    context.scale(1.5F, 1.5F);
+    context.set_pattern(fill_style, pattern.data(), 16, 16, 16 * 4, repeat);
+    context.fill_rectangle(-100, -100, 400, 400);
+    context.restore();
+
+    // Each image pixel becomes 4x4 canvas pixels either way
+    if (replicated) {
+        auto const image = noise_image(16, 4);
+        context.draw_image(image.data(), 64, 64, 64 * 4, 8, 8, 64, 64);
+    } else {
+        auto const image = noise_image(16, 1);
+        context.draw_image(image.data(), 16, 16, 16 * 4, 8, 8, 64, 64);
+    }
+
+    auto const image = noise_image(16, 1);
+    auto const checker = checker_image(200);
+    context.draw_image(checker.data(), 16, 16, 16 * 4, 80, 100, 37.5F, 70);
+    context.image_filter = bilinear;
+    context.draw_image(image.data(), 16, 16, 16 * 4, 88, 8, 90.5F, 70);
+    context.draw_image(checker.data(), 16, 16, 16 * 4, 130, 100, 9, 7);
+    auto const large = noise_image(64, 1);
+    context.draw_image(large.data(), 64, 64, 64 * 4, 8, 100, 29, 23);
+    context.image_filter = nearest;
+    context.draw_image(large.data(), 64, 64, 64 * 4, 8, 140, 29, 23);
+    context.image_filter = bilinear;
+    context.translate(205, 125);
+    context.rotate(0.6F);
+    context.draw_image(checker.data(), 16, 16, 16 * 4, -30, -30, 60, 60);
+}
+
+#endif
+
+}
+
+std::vector<unsigned char> render_scene(canvas_test::Scene scene, [[maybe_unused]] int threads)
+{
+    canvas context(canvas_test::SCENE_WIDTH, canvas_test::SCENE_HEIGHT);
+#ifdef CANVAS_ITY_THREADS
+    context.set_thread_count(threads);
+#endif
+    switch (scene) {
+    case canvas_test::Scene::SHAPES:
+        draw_shapes(context);
+        break;
+    case canvas_test::Scene::SHADOWS:
+        draw_shadows(context);
+        break;
+    case canvas_test::Scene::COMPOSITING:
+        draw_compositing(context);
+        break;
+    case canvas_test::Scene::POLYGON:
+        draw_polygon(context);
+        break;
+    case canvas_test::Scene::IMAGES:
+        draw_images(context);
+        break;
+    case canvas_test::Scene::TRANSFER:
+        draw_transfer(context);
+        break;
+#ifndef CANVAS_TEST_V100_API
+    case canvas_test::Scene::INSTANCED:
+        draw_instanced(context, true);
+        break;
+    case canvas_test::Scene::RETAINED:
+        draw_retained(context, true);
+        break;
+    case canvas_test::Scene::TEXT:
+        draw_text(context, true);
+        break;
+    case canvas_test::Scene::IMAGE_FILTERS:
+        draw_image_filters(context, false);
+        break;
+    case canvas_test::Scene::INSTANCED_PER_COPY:
+        draw_instanced(context, false);
+        break;
+    case canvas_test::Scene::RETAINED_IMMEDIATE:
+        draw_retained(context, false);
+        break;
+    case canvas_test::Scene::TEXT_UNCACHED:
+        draw_text(context, false);
+        break;
+    case canvas_test::Scene::IMAGE_FILTERS_REPLICATED:
+        draw_image_filters(context, true);
+        break;
+#else
+    default: // Not drawable through the API of v1.00
+        break;
+#endif
+    }
+    std::vector<unsigned char> pixels(static_cast<size_t>(canvas_test::SCENE_WIDTH * canvas_test::SCENE_HEIGHT * 4));
+    context.get_image_data(pixels.data(), canvas_test::SCENE_WIDTH, canvas_test::SCENE_HEIGHT,
+        canvas_test::SCENE_WIDTH * 4, 0, 0);
+    return pixels;
+}
+
+}
+
+#endif // SCENES_HPP
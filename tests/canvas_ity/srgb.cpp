@@ -0,0 +1,71 @@
+// Checks the table driven sRGB conversions in canvas_ity against the exact
+// formulas, which are only reachable from within the implementation.
+//
+// Usage: canvas_ity_srgb
+
+#define CANVAS_ITY_IMPLEMENTATION
+#include <canvas_ity/canvas_ity.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+double exact_linearized(double value)
+{
+    return value < 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4);
+}
+
+double exact_delinearized(double value)
+{
+    return value < 0.0031308 ? 12.92 * value : 1.055 * std::pow(value, 1 / 2.4) - 0.055;
+}
+
+// Reports the worst error found, failing if it is over the bound
+bool check(char const* label, double worst, double bound)
+{
+    bool const within = worst <= bound;
+    std::printf("%-30s worst %.4g, bound %.4g%s\n", label, worst, bound, within ? "" : "  FAILED");
+    return within;
+}
+
+}
+
+int main()
+{
+    bool passed = true;
+
+    // Every 16-bit entry is the exact linear value, rounded
+    double worst = 0;
+    for (int level = 0; level < 256; ++level) {
+        double const exact = exact_linearized(level / 255.0) * 65535;
+        worst = std::max(worst, std::abs(canvas_ity::linearize_table[level] - exact));
+    }
+    passed = check("linearize_table, 16-bit units", worst, 0.5) && passed;
+
+    // The interpolated curve, swept densely over the whole linear range, in
+    // units of an 8-bit level of the result
+    static constexpr int STEPS = 1 << 22;
+    worst = 0;
+    for (int step = 0; step <= STEPS; ++step) {
+        float const value = static_cast<float>(step) / STEPS;
+        double const error = canvas_ity::delinearized(value) - exact_delinearized(value);
+        worst = std::max(worst, std::abs(error) * 255);
+    }
+    passed = check("delinearized(), 8-bit levels", worst, 0.013) && passed;
+
+    // Every 8-bit level comes back unchanged from the 16-bit linear value it
+    // unpacks to, through both the table used for 8-bit pixels and the curve
+    int changed = 0;
+    for (int level = 0; level < 256; ++level) {
+        unsigned short const linear = canvas_ity::linearize_table[level];
+        float const curve = canvas_ity::delinearized(linear / 65535.0F) * 255;
+        changed += canvas_ity::delinearize_table[linear >> 4] != level ? 1 : 0;
+        changed += static_cast<int>(curve + 0.5F) != level ? 1 : 0;
+    }
+    passed = check("8-bit round trips changed", changed, 0) && passed;
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
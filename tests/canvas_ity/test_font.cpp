@@ -0,0 +1,207 @@
+// Builds a small TrueType font for the text scenes, since the repo ships no
+// font of its own. Each printable ASCII character gets a glyph of its own,
+// a wavy ring around a hole, so that a full line of text fills the glyph
+// cache with distinct outlines.
+
+#include "renders.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <numbers>
+#include <string_view>
+
+namespace canvas_test {
+
+namespace {
+
+constexpr int UNITS_PER_EM = 1000;
+constexpr int ADVANCE = 620;
+constexpr int FIRST_CHARACTER = '!';
+constexpr int GLYPHS = '~' - FIRST_CHARACTER + 2; // After the empty .notdef
+
+void put_16(std::vector<unsigned char>& data, int value)
+{
+    data.push_back(static_cast<unsigned char>(value >> 8));
+    data.push_back(static_cast<unsigned char>(value));
+}
+
+void put_32(std::vector<unsigned char>& data, uint32_t value)
+{
+    put_16(data, static_cast<int>(value >> 16U));
+    put_16(data, static_cast<int>(value & 0xffffU));
+}
+
+void set_16(std::vector<unsigned char>& data, size_t at, int value)
+{
+    data[at] = static_cast<unsigned char>(value >> 8);
+    data[at + 1] = static_cast<unsigned char>(value);
+}
+
+struct Point {
+    int x;
+    int y;
+    bool on_curve;
+};
+
+// Outer ring of alternating on and off curve points, starting off the curve
+// on odd characters, around a hole of off curve points wound the other way
+std::vector<std::vector<Point>> glyph_contours(int character)
+{
+    constexpr double PI = std::numbers::pi;
+    int const lobes = 5 + character % 6;
+    double const stretch = 0.75 + 0.05 * (character % 7);
+    std::vector<Point> ring;
+    for (int i = 0; i < 2 * lobes; ++i) {
+        double const angle = -PI * (i + character % 2) / lobes;
+        double const radius = i % 2 == 0 ? 250 : 330 + 6 * (character % 9);
+        ring.push_back({ static_cast<int>(std::lround(300 + radius * stretch * std::cos(angle))),
+            static_cast<int>(std::lround(330 + radius * std::sin(angle))), (i + character) % 2 == 0 });
+    }
+    std::vector<Point> hole;
+    for (int i = 0; i < 6; ++i) {
+        double const angle = PI * i / 3;
+        hole.push_back({ static_cast<int>(std::lround(300 + 90 * std::cos(angle))),
+            static_cast<int>(std::lround(330 + 120 * std::sin(angle))), false });
+    }
+    return { ring, hole };
+}
+
+// Simple glyph with one flag byte and 16-bit x and y deltas for each point
+std::vector<unsigned char> glyph_data(std::vector<std::vector<Point>> const& contours)
+{
+    int x_min = UNITS_PER_EM;
+    int y_min = UNITS_PER_EM;
+    int x_max = -UNITS_PER_EM;
+    int y_max = -UNITS_PER_EM;
+    for (auto const& contour : contours) {
+        for (auto const& point : contour) {
+            x_min = std::min(x_min, point.x);
+            y_min = std::min(y_min, point.y);
+            x_max = std::max(x_max, point.x);
+            y_max = std::max(y_max, point.y);
+        }
+    }
+    std::vector<unsigned char> data;
+    put_16(data, static_cast<int>(contours.size()));
+    put_16(data, x_min);
+    put_16(data, y_min);
+    put_16(data, x_max);
+    put_16(data, y_max);
+    int end = -1;
+    for (auto const& contour : contours) {
+        end += static_cast<int>(contour.size());
+        put_16(data, end);
+    }
+    put_16(data, 0); // No instructions
+    for (auto const& contour : contours) {
+        for (auto const& point : contour) {
+            data.push_back(point.on_curve ? 1 : 0);
+        }
+    }
+    for (bool const vertical : { false, true }) {
+        int last = 0;
+        for (auto const& contour : contours) {
+            for (auto const& point : contour) {
+                int const value = vertical ? point.y : point.x;
+                put_16(data, value - last);
+                last = value;
+            }
+        }
+    }
+    data.resize((data.size() + 3) & ~size_t { 3 });
+    return data;
+}
+
+}
+
+std::vector<unsigned char> const& test_font()
+{
+    static std::vector<unsigned char> const font = [] {
+        std::vector<unsigned char> glyf;
+        std::vector<unsigned char> loca;
+        std::vector<unsigned char> hmtx;
+        put_32(loca, 0);
+        put_16(hmtx, ADVANCE);
+        put_16(hmtx, 0);
+        for (int character = FIRST_CHARACTER; character < FIRST_CHARACTER + GLYPHS - 1; ++character) {
+            auto const contours = glyph_contours(character);
+            auto const data = glyph_data(contours);
+            glyf.insert(glyf.end(), data.begin(), data.end());
+            put_32(loca, static_cast<uint32_t>(glyf.size()));
+            put_16(hmtx, ADVANCE);
+            put_16(hmtx, (data[2] << 8) | data[3]); // Left side bearing at x_min
+        }
+
+        std::vector<unsigned char> head(54);
+        set_16(head, 0, 1); // Version 1.0
+        set_16(head, 12, 0x5f0f);
+        set_16(head, 14, 0x3cf5);
+        set_16(head, 18, UNITS_PER_EM);
+        set_16(head, 50, 1); // 32-bit loca offsets
+
+        std::vector<unsigned char> hhea(36);
+        set_16(hhea, 0, 1);
+        set_16(hhea, 4, 800);
+        set_16(hhea, 6, -200);
+        set_16(hhea, 10, ADVANCE);
+        set_16(hhea, 34, GLYPHS);
+
+        std::vector<unsigned char> maxp(6);
+        set_16(maxp, 0, 0);
+        set_16(maxp, 2, 0x5000);
+        set_16(maxp, 4, GLYPHS);
+
+        std::vector<unsigned char> os_2(78);
+        set_16(os_2, 68, 800);
+        set_16(os_2, 70, -200);
+
+        // Format 0, for the Macintosh Roman encoding
+        std::vector<unsigned char> cmap;
+        put_16(cmap, 0);
+        put_16(cmap, 1);
+        put_16(cmap, 1);
+        put_16(cmap, 0);
+        put_32(cmap, 12);
+        put_16(cmap, 0);
+        put_16(cmap, 262);
+        put_16(cmap, 0);
+        for (int character = 0; character < 256; ++character) {
+            bool const drawn = FIRST_CHARACTER <= character && character < FIRST_CHARACTER + GLYPHS - 1;
+            cmap.push_back(static_cast<unsigned char>(drawn ? character - FIRST_CHARACTER + 1 : 0));
+        }
+
+        std::pair<std::string_view, std::vector<unsigned char> const*> const tables[] = {
+            { "OS/2", &os_2 },
+            { "cmap", &cmap },
+            { "glyf", &glyf },
+            { "head", &head },
+            { "hhea", &hhea },
+            { "hmtx", &hmtx },
+            { "loca", &loca },
+            { "maxp", &maxp },
+        };
+        std::vector<unsigned char> file;
+        put_32(file, 0x00010000);
+        put_16(file, static_cast<int>(std::size(tables)));
+        put_16(file, 128); // Search range, entry selector and range shift
+        put_16(file, 3);
+        put_16(file, 0);
+        auto offset = static_cast<uint32_t>(12 + 16 * std::size(tables));
+        for (auto const& [tag, table] : tables) {
+            file.insert(file.end(), tag.begin(), tag.end());
+            put_32(file, 0); // Checksums go unchecked
+            put_32(file, offset);
+            put_32(file, static_cast<uint32_t>(table->size()));
+            offset += static_cast<uint32_t>((table->size() + 3) & ~size_t { 3 });
+        }
+        for (auto const& [tag, table] : tables) {
+            file.insert(file.end(), table->begin(), table->end());
+            file.resize((file.size() + 3) & ~size_t { 3 });
+        }
+        return file;
+    }();
+    return font;
+}
+
+}
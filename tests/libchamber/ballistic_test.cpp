@@ -0,0 +1,65 @@
+// Regression tests for the event driven BallisticEngine. Each case steps a
+// single ball for a few simulated seconds, so one that livelocks on an event
+// hangs and is failed by the ctest timeout.
+//
+// Usage: ballistic_test
+
+#include <libchamber/ballistic.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <span>
+
+namespace {
+
+constexpr float FRAME = 1.F / 60.F;
+
+ball run(chamber::BallisticEngine& engine, ball state, float seconds)
+{
+    for (float t = 0.F; t < seconds; t += FRAME) {
+        engine.step(std::span(&state, 1), FRAME);
+    }
+    return state;
+}
+
+bool check(char const* label, bool passed)
+{
+    std::printf("%-52s %s\n", label, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+// A ball placed overlapping a wall, with no speed across it, used to be
+// resolved at the same instant forever
+bool overlapping_wall()
+{
+    chamber::BallisticEngine engine(0.9F);
+    engine.add_surface({ .a = { 0.5F, 0.F }, .b = { 0.5F, 1.F } });
+    ball const placed { .pos = { 0.49F, 0.9F }, .r = 0.02F, .velocity = { 0.F, 0.F } };
+    ball const after = run(engine, placed, 0.25F);
+    return check("ball overlapping a wall falls", after.pos.x == placed.pos.x && after.pos.y < placed.pos.y);
+}
+
+// A ball sliding off the end of a surface used to be able to land straight
+// back on it and then slide on past the end in mid-air
+bool slides_off_end(float speed)
+{
+    chamber::BallisticEngine engine(0.5F);
+    engine.add_surface({ .a = { 0.2F, 0.5F }, .b = { 0.8F, 0.5F } });
+    ball const dropped { .pos = { 0.5F, 0.53F }, .r = 0.02F, .velocity = { speed, 0.F } };
+    ball const after = run(engine, dropped, 4.F);
+    return after.pos.y < 0.F;
+}
+
+}
+
+int main()
+{
+    bool passed = overlapping_wall();
+
+    bool fell = true;
+    for (int i = 0; i < 100; ++i) {
+        fell = slides_off_end(0.2F + static_cast<float>(i) * 0.01F) && fell;
+    }
+    passed = check("ball sliding off a surface falls, at 100 speeds", fell) && passed;
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,31 @@
+// libphysics is only distributed built for WebAssembly, so the native tests
+// define the vector helpers from its header that the libchamber sources under
+// test call. The ball and surface physics itself is not stood in for.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <libphysics/physics.h>
+#ifdef __cplusplus
+}
+#endif
+#include <cmath>
+
+extern "C" {
+
+pos2 pos2_add(pos2 const* p, vec2 const* v) { return { p->x + v->x, p->y + v->y }; }
+vec2 pos2_sub(pos2 const* a, pos2 const* b) { return { a->x - b->x, a->y - b->y }; }
+
+float vec2_length_2(vec2 const* v) { return v->x * v->x + v->y * v->y; }
+float vec2_length(vec2 const* v) { return std::sqrt(vec2_length_2(v)); }
+vec2 vec2_add(vec2 const* a, vec2 const* b) { return { a->x + b->x, a->y + b->y }; }
+vec2 vec2_sub(vec2 const* a, vec2 const* b) { return { a->x - b->x, a->y - b->y }; }
+vec2 vec2_mul(vec2 const* vec, float multiplier) { return { vec->x * multiplier, vec->y * multiplier }; }
+float vec2_dot(vec2 const* a, vec2 const* b) { return a->x * b->x + a->y * b->y; }
+vec2 vec2_normalized(vec2 const* v)
+{
+    float const length = vec2_length(v);
+    return { v->x / length, v->y / length };
+}
+
+}
@@ -0,0 +1,104 @@
+// Checks fill_circle() against the disc it approximates: its total coverage
+// against the exact area, pixels wholly inside filled solid, pixels wholly
+// outside untouched, and nothing written outside the clip or the canvas.
+//
+// Usage: primitives_test
+
+#include <libchamber/primitives.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <numbers>
+#include <vector>
+
+namespace {
+
+using chamber::PixelRect;
+
+constexpr size_t WIDTH = 64;
+constexpr size_t HEIGHT = 48;
+constexpr uint32_t COLOR = 0xFFFFFFFFU;
+constexpr uint32_t SENTINEL = 0x12345678U;
+
+struct Disc {
+    pos2 center;
+    float radius;
+};
+
+// Distances from the center to the nearest and farthest points of a pixel
+std::pair<float, float> pixel_reach(pos2 center, int x, int y)
+{
+    float const left = static_cast<float>(x) - center.x;
+    float const top = static_cast<float>(y) - center.y;
+    float const near_x = std::max({ left, 0.F, -(left + 1.F) });
+    float const near_y = std::max({ top, 0.F, -(top + 1.F) });
+    float const far_x = std::max(std::abs(left), std::abs(left + 1.F));
+    float const far_y = std::max(std::abs(top), std::abs(top + 1.F));
+    return { std::hypot(near_x, near_y), std::hypot(far_x, far_y) };
+}
+
+bool check_disc(Disc disc, PixelRect clip)
+{
+    // The canvas sits between a row of sentinels either side, to catch
+    // writes past its ends
+    std::vector<uint32_t> memory((HEIGHT + 2) * WIDTH, SENTINEL);
+    auto const canvas = std::span(memory).subspan(WIDTH, WIDTH * HEIGHT);
+    std::ranges::fill(canvas, 0U);
+    chamber::fill_circle(disc.center, disc.radius, COLOR, clip, canvas, WIDTH);
+
+    PixelRect const visible = clip.intersected({ 0, 0, static_cast<int>(WIDTH), static_cast<int>(HEIGHT) });
+    bool const sentinels = std::ranges::all_of(std::span(memory).first(WIDTH), [](uint32_t p) { return p == SENTINEL; })
+        && std::ranges::all_of(std::span(memory).last(WIDTH), [](uint32_t p) { return p == SENTINEL; });
+    double coverage = 0;
+    int wrong = 0;
+    for (int y = 0; y < static_cast<int>(HEIGHT); ++y) {
+        for (int x = 0; x < static_cast<int>(WIDTH); ++x) {
+            uint32_t const pixel = canvas[static_cast<size_t>(y) * WIDTH + static_cast<size_t>(x)];
+            bool const clipped = x < visible.left || x >= visible.right || y < visible.top || y >= visible.bottom;
+            auto const [nearest, farthest] = pixel_reach(disc.center, x, y);
+            coverage += (pixel >> 24U) / 255.0;
+            if ((clipped || nearest >= disc.radius) && pixel != 0) {
+                ++wrong;
+            } else if (!clipped && farthest <= disc.radius && pixel != COLOR) {
+                ++wrong;
+            }
+        }
+    }
+
+    bool const whole = visible.left == 0 && visible.top == 0 && visible.right == static_cast<int>(WIDTH)
+        && visible.bottom == static_cast<int>(HEIGHT)
+        && disc.center.x - disc.radius >= 0.F && disc.center.x + disc.radius <= static_cast<float>(WIDTH)
+        && disc.center.y - disc.radius >= 0.F && disc.center.y + disc.radius <= static_cast<float>(HEIGHT);
+    // Coverage is distance based, so it only approximates the area of the
+    // edge pixels, but the errors either side of the edge cancel out
+    double const area = std::numbers::pi * disc.radius * disc.radius;
+    bool const area_ok = !whole || std::abs(coverage - area) <= 0.02 * area + 0.5;
+
+    bool const passed = sentinels && wrong == 0 && area_ok;
+    std::printf("radius %5.2f at (%5.2f, %5.2f): %d misplaced pixels, coverage %7.2f%s%s%s\n", disc.radius,
+        disc.center.x, disc.center.y, wrong, coverage, whole ? "" : " (clipped)", sentinels ? "" : ", wrote past the canvas",
+        passed ? "" : "  FAILED");
+    return passed;
+}
+
+}
+
+int main()
+{
+    PixelRect const all { 0, 0, static_cast<int>(WIDTH), static_cast<int>(HEIGHT) };
+    bool passed = true;
+    for (float const radius : { 0.3F, 1.F, 2.5F, 7.25F, 15.F, 20.F }) {
+        for (float const offset : { 0.F, 0.25F, 0.5F, 0.8F }) {
+            passed = check_disc({ { 32.F + offset, 24.F + offset * 0.5F }, radius }, all) && passed;
+        }
+    }
+    // Crossing each edge of the canvas, and a clip inside it
+    passed = check_disc({ { 2.F, 24.F }, 10.F }, all) && passed;
+    passed = check_disc({ { 62.3F, 20.F }, 10.F }, all) && passed;
+    passed = check_disc({ { 30.F, 1.5F }, 10.F }, all) && passed;
+    passed = check_disc({ { 30.F, 46.7F }, 10.F }, all) && passed;
+    passed = check_disc({ { 0.F, 0.F }, 80.F }, all) && passed;
+    passed = check_disc({ { 32.F, 24.F }, 15.F }, { 20, 10, 40, 30 }) && passed;
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
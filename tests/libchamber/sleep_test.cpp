@@ -0,0 +1,81 @@
+// Drops and throws a ball onto a floor at several step lengths and checks the
+// SleepTracker only puts it to sleep once it rests on the floor, never around
+// the apex of a bounce.
+//
+// Usage: sleep_test
+
+#include <libchamber/sleep.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <span>
+
+namespace {
+
+constexpr float GRAVITY = -9.832F;
+constexpr float ELASTICITY = 0.5F;
+constexpr float RADIUS = 0.02F;
+
+struct Outcome {
+    bool slept; // By the end
+    bool slept_in_air; // At any point
+};
+
+// Simulates one ball against a floor at y = 0, standing in for the chamber's
+// physics, with a tick per frame split into equal steps of step_len
+Outcome simulate(ball state, float step_len)
+{
+    static constexpr float FRAME = 1.F / 60.F;
+    static constexpr float SECONDS = 5.F;
+    auto const steps_per_frame = static_cast<int>(FRAME / step_len + 0.5F);
+
+    chamber::SleepTracker sleep;
+    auto const balls = std::span(&state, 1);
+    Outcome outcome {};
+    for (float t = 0.F; t < SECONDS; t += FRAME) {
+        sleep.begin_step(balls);
+        for (int step = 0; step < steps_per_frame; ++step) {
+            for (auto const i : sleep.awake()) {
+                auto& ball = balls[i];
+                ball.velocity.y += GRAVITY * step_len;
+                ball.pos.x += ball.velocity.x * step_len;
+                ball.pos.y += ball.velocity.y * step_len;
+                if (ball.pos.y < ball.r) {
+                    ball.pos.y = ball.r;
+                    ball.velocity.y *= ball.velocity.y < 0.F ? -ELASTICITY : 1.F;
+                    sleep.mark_supported(i);
+                }
+            }
+            sleep.end_step(balls, step_len);
+            if (sleep.is_sleeping(0) && state.pos.y > state.r + chamber::SleepTracker::SLEEP_DISTANCE) {
+                outcome.slept_in_air = true;
+            }
+        }
+    }
+    outcome.slept = sleep.is_sleeping(0);
+    return outcome;
+}
+
+}
+
+int main()
+{
+    // The guard's fixed step, a finer adaptive substep, and a frame per step
+    static constexpr float STEP_LENS[] = { 1.F / 780.F, 1.F / 6000.F, 1.F / 60.F };
+    static constexpr ball STARTS[] = {
+        { .pos = { 0.5F, 0.4F }, .r = RADIUS, .velocity = { 0.F, 0.F } }, // Dropped
+        { .pos = { 0.5F, RADIUS }, .r = RADIUS, .velocity = { 0.F, 1.F } }, // Thrown up
+        { .pos = { 0.5F, 0.1F }, .r = RADIUS, .velocity = { 0.F, 0.3F } }, // Lobbed
+    };
+
+    bool passed = true;
+    for (auto const step_len : STEP_LENS) {
+        for (auto const& start : STARTS) {
+            auto const [slept, slept_in_air] = simulate(start, step_len);
+            bool const ok = slept && !slept_in_air;
+            std::printf("step %.6f s, from y %.2f at %.2f/s: %s%s%s\n", step_len, start.pos.y, start.velocity.y,
+                slept ? "slept" : "never slept", slept_in_air ? ", in mid-air" : "", ok ? "" : "  FAILED");
+            passed = passed && ok;
+        }
+    }
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}